@@ -0,0 +1,82 @@
+// Loads a synthetic 1M-row <id>_patients.csv (every tenth name quoted with
+// a comma inside) with the original stringstream/getline loader and with
+// Hospital::loadData() over csv_io.h's CsvReader, and reports rows/s.
+//
+//   g++ -std=c++17 -O2 -pthread -o csv_load_bench bench/csv_load_bench.cpp
+//   ./csv_load_bench [rows]
+#include <chrono>
+#define main hospital_main
+#include "../hospital.cpp"
+#undef main
+
+using Clock = chrono::steady_clock;
+
+static double secondsSince(Clock::time_point t0)
+{
+    return chrono::duration<double>(Clock::now() - t0).count();
+}
+
+// The loader hospital.cpp used before CsvReader: a stringstream and a
+// fresh vector<string> per line, stoi on copies, no quoting.
+static size_t loadWithStringstream(const string &fn)
+{
+    ifstream f(fn);
+    string line;
+    getline(f, line);
+    vector<Patient> out;
+    while (getline(f, line))
+    {
+        stringstream ss(line);
+        vector<string> cols;
+        string tok;
+        while (getline(ss, tok, ','))
+            cols.push_back(tok);
+        out.push_back({stoi(cols[0]), cols[1], cols[2], cols[3]});
+    }
+    return out.size();
+}
+
+int main(int argc, char *argv[])
+{
+    size_t rows = argc > 1 ? stoul(argv[1]) : 1000000;
+    filesystem::path dir = filesystem::temp_directory_path() / "csv_load_bench_data";
+    filesystem::create_directories(dir);
+    string prefix = (dir / "H1").string(), fn = prefix + "_patients.csv";
+
+    {
+        CsvWriter w(fn, rows * 40);
+        w.header("id,name,dob,gender");
+        for (size_t i = 1; i <= rows; ++i)
+        {
+            string name = i % 10 ? "Patient " + to_string(i) : "Doe, Jane " + to_string(i);
+            w.field((int)i).field(name).field("1990-01-01").field(i % 2 ? "F" : "M");
+            w.endRow();
+        }
+        if (!w.commit())
+        {
+            cerr << "Cannot write " << fn << "\n";
+            return 1;
+        }
+    }
+    cout << rows << " rows, " << filesystem::file_size(fn) / (1 << 20) << " MiB\n";
+
+    auto t0 = Clock::now();
+    size_t before = loadWithStringstream(fn);
+    double sBefore = secondsSince(t0);
+
+    Hospital h("H1", "Bench", "Nowhere");
+    h.storePrefix = prefix;
+    t0 = Clock::now();
+    h.ensureLoaded();
+    double sAfter = secondsSince(t0);
+
+    // The old loader splits quoted names at their comma; both still count
+    // one row per line.
+    cout << "stringstream: " << before << " rows in " << sBefore << " s ("
+         << (size_t)(before / sBefore) << " rows/s)\n";
+    cout << "CsvReader:    " << h.patients.size() << " rows in " << sAfter << " s ("
+         << (size_t)(h.patients.size() / sAfter) << " rows/s)\n";
+    cout << "quoted name kept whole: " << (h.patients[9].name == "Doe, Jane 10" ? "yes" : "no") << "\n";
+    filesystem::remove_all(dir);
+    return 0;
+}
@@ -0,0 +1,81 @@
+// Throughput of ParkingNetwork::ingestEvents() over a synthetic day of gate
+// traffic: L lots (default 10) of 1500 spots (Car, Motorcycle, Van) and 5000
+// registered vehicles each, with more motorcycles than motorcycle spots;
+// every vehicle makes four visits spread over the day, entering with "*"
+// (best fitting spot) and leaving 10 minutes to 2 hours later. The IN/OUT
+// lines are sorted by time and fed through one ingestEvents() call,
+// flushing every `batch` events.
+//
+//   g++ -std=c++17 -O2 -pthread -o ingest_bench bench/ingest_bench.cpp
+//   ./ingest_bench [lots] [batch]
+#include <chrono>
+#include <random>
+#define main pvms_main
+#include "../pvms.cpp"
+#undef main
+
+int main(int argc, char *argv[])
+{
+    int lots = argc > 1 ? stoi(argv[1]) : 10;
+    size_t batch = argc > 2 ? stoul(argv[2]) : 1000;
+    const int spotsPerLot = 1500, vehiclesPerLot = 5000, visits = 4;
+    filesystem::path dir = filesystem::temp_directory_path() / "ingest_bench_data";
+    filesystem::remove_all(dir);
+    DataStore::root = dir.string();
+
+    mt19937 rng(7);
+    vector<pair<int64_t, string>> events;
+    {
+        ParkingNetwork pn;
+        pn.setDumpInterval(0);
+        // Spot and vehicle mixes differ, so "*" has to move motorcycles up
+        // the size ladder once their own spots are taken.
+        const char *spotTypes[] = {"Car", "Car", "Car", "Motorcycle", "Van"};
+        const char *vehicleTypes[] = {"Car", "Car", "Motorcycle", "Motorcycle", "Van"};
+        int64_t midnight = time(0) / 86400 * 86400;
+        uniform_int_distribution<int64_t> arrive(0, 4 * 3600), stay(600, 7200);
+        for (int l = 1; l <= lots; ++l)
+        {
+            istringstream form("Lot " + to_string(l) + "\nBench\n");
+            ostringstream prompts;
+            streambuf *keyboard = cin.rdbuf(form.rdbuf()), *screen = cout.rdbuf(prompts.rdbuf());
+            pn.addParkingLot();
+            cin.rdbuf(keyboard);
+            cout.rdbuf(screen);
+            string lotId = "L" + to_string(l);
+            ParkingLot *lot = pn.nodes[pn.lookup(lotId)];
+            lot->beginBatch();
+            for (int s = 0; s < spotsPerLot; ++s)
+                lot->addParkingSpot(spotTypes[s % 5], "Z" + to_string(s % 4), s % 3, s % 200);
+            for (int v = 0; v < vehiclesPerLot; ++v)
+            {
+                string plate = "R" + to_string(l) + "-" + to_string(v);
+                lot->registerVehicle(plate, vehicleTypes[v % 5], "Owner");
+                // One visit per quarter of the day, so a vehicle never
+                // enters while it is still parked.
+                for (int k = 0; k < visits; ++k)
+                {
+                    int64_t in = midnight + k * 6 * 3600 + arrive(rng), out = in + stay(rng);
+                    events.push_back({in, "IN," + lotId + "," + plate + ",*," + to_string(in)});
+                    events.push_back({out, "OUT," + lotId + "," + plate + "," + to_string(out)});
+                }
+            }
+            lot->endBatch();
+        }
+    }
+    stable_sort(events.begin(), events.end(), [](const auto &a, const auto &b)
+                { return a.first < b.first; });
+    string feed;
+    for (auto &e : events)
+        feed += e.second + "\n";
+
+    ParkingNetwork pn;
+    pn.setDumpInterval(0);
+    istringstream in(feed);
+    ostringstream results;
+    cout << lots << " lot(s), " << events.size() << " events, batch " << batch << ": ";
+    cout.flush();
+    pn.ingestEvents(in, results, cout, batch);
+    filesystem::remove_all(dir);
+    return 0;
+}
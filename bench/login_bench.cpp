@@ -0,0 +1,81 @@
+// Login latency in pms with N registered users (default 100k, attendants
+// and admins): times login() end to end for Q random users, whose hashes
+// use the production PASSWORD_ITERATIONS, and separately the user lookup
+// alone, through the email index and through the linear scan (copying each
+// User) that login() used to do. The other users get single-iteration
+// hashes so the store can be filled quickly; lookup cost does not depend
+// on them.
+//
+//   g++ -std=c++17 -O2 -pthread -o login_bench bench/login_bench.cpp
+//   ./login_bench [users] [logins]
+#include <chrono>
+#include <random>
+#include <sstream>
+#define main pms_main
+#include "../pms.cpp"
+#undef main
+
+using Clock = chrono::steady_clock;
+
+static double secondsSince(Clock::time_point t0) {
+    return chrono::duration<double>(Clock::now() - t0).count();
+}
+
+static string emailOf(int id) {
+    return "user" + to_string(id) + "@example.com";
+}
+
+int main(int argc, char *argv[]) {
+    int n = argc > 1 ? stoi(argv[1]) : 100000;
+    int q = argc > 2 ? stoi(argv[2]) : 20;
+    mt19937 rng(3);
+    vector<int> sample;
+    for (int i = 0; i < q; ++i)
+        sample.push_back(1 + rng() % n);
+    sort(sample.begin(), sample.end());
+
+    auto t0 = Clock::now();
+    users.reserve(n);
+    for (int id = 1; id <= n; ++id) {
+        bool timed = binary_search(sample.begin(), sample.end(), id);
+        User u{id, "First", "Last" + to_string(id), emailOf(id), "", id % 20 ? "attendant" : "admin"};
+        u.passwordHash = hashPassword("secret" + to_string(id), timed ? PASSWORD_ITERATIONS : 1);
+        applyUser(u);
+    }
+    cout << n << " users registered in " << secondsSince(t0) << " s\n";
+
+    int ok = 0;
+    t0 = Clock::now();
+    for (int id : sample) {
+        istringstream form(emailOf(id) + " secret" + to_string(id) + "\n");
+        ostringstream replies;
+        streambuf *keyboard = cin.rdbuf(form.rdbuf()), *screen = cout.rdbuf(replies.rdbuf());
+        ok += login();
+        cin.rdbuf(keyboard);
+        cout.rdbuf(screen);
+    }
+    double sLogin = secondsSince(t0);
+
+    const int lookups = 1000;
+    size_t found = 0;
+    t0 = Clock::now();
+    for (int i = 0; i < lookups; ++i)
+        found += userByEmail.count(emailOf(sample[i % q]));
+    double sIndex = secondsSince(t0);
+    t0 = Clock::now();
+    for (int i = 0; i < lookups / 100; ++i) {
+        string email = emailOf(sample[i % q]);
+        for (User u : users)
+            if (u.email == email) {
+                ++found;
+                break;
+            }
+    }
+    double sScan = secondsSince(t0);
+
+    cout << "login():        " << sLogin / q * 1e3 << " ms each (" << ok << "/" << q << " accepted, "
+         << PASSWORD_ITERATIONS << " PBKDF2 iterations)\n";
+    cout << "index lookup:   " << sIndex / lookups * 1e6 << " us each\n";
+    cout << "copying scan:   " << sScan / (lookups / 100) * 1e6 << " us each\n";
+    return found ? 0 : 1;
+}
@@ -0,0 +1,158 @@
+// Concurrency stress for ParkingNetwork::gateEvent(): T gate threads
+// (default 8) each send N random events (default 20000) to two small lots
+// whose 24 spots and 60 plates are shared by every thread, so INs race for
+// the same spots and OUTs race with INs of the same plate. A reader thread
+// runs nearest-available queries and the occupancy dumper fires every
+// second meanwhile. Afterwards, and again after reloading the lots from
+// disk, it checks that
+//   - no spot and no plate has more than one open session,
+//   - each spot is marked occupied exactly when it has an open session,
+//   - the per-type occupied counters add up to the open sessions,
+//   - accepted INs minus accepted OUTs equals the open sessions, and
+//     accepted OUTs equal the closed sessions.
+// Exits non-zero on any violation.
+//
+//   g++ -std=c++17 -O2 -pthread -o pvms_stress bench/pvms_stress.cpp
+//   ./pvms_stress [threads] [events per thread]
+#include <random>
+#define main pvms_main
+#include "../pvms.cpp"
+#undef main
+
+static int failures = 0;
+
+static void check(bool ok, const string &what)
+{
+    if (!ok)
+    {
+        cout << "FAIL: " << what << "\n";
+        ++failures;
+    }
+}
+
+struct GateTally
+{
+    atomic<int> ins{0}, outs{0};
+};
+
+static int countList(const ParkingSession *s)
+{
+    int n = 0;
+    for (; s; s = s->next)
+        ++n;
+    return n;
+}
+
+static void checkLot(ParkingLot *lot, const GateTally &tally, const string &when)
+{
+    string at = lot->lotId + " " + when + ": ";
+    unordered_map<int, int> perSpot;
+    unordered_map<string, int> perPlate;
+    int open = 0;
+    for (auto *s = lot->activeSessions; s; s = s->next, ++open)
+    {
+        check(++perSpot[s->spotId] == 1, at + "spot " + to_string(s->spotId) + " has two open sessions");
+        check(++perPlate[s->vehicleId] == 1, at + s->vehicleId + " has two open sessions");
+    }
+    for (auto *spot = lot->spots; spot; spot = spot->next)
+        check(spot->isOccupied == (perSpot.count(spot->id) > 0),
+              at + "spot " + to_string(spot->id) + " occupied flag disagrees with its sessions");
+    int occupied = 0;
+    for (auto &t : lot->occupancy())
+        occupied += t.occupied;
+    check(occupied == open, at + to_string(occupied) + " spots counted occupied, " + to_string(open) + " open sessions");
+    check(tally.ins - tally.outs == open, at + to_string(tally.ins) + " INs - " + to_string(tally.outs) +
+                                              " OUTs != " + to_string(open) + " open sessions");
+    check(countList(lot->sessions) == tally.outs, at + "closed sessions != accepted OUTs");
+}
+
+int main(int argc, char *argv[])
+{
+    int threads = argc > 1 ? stoi(argv[1]) : 8;
+    int events = argc > 2 ? stoi(argv[2]) : 20000;
+    const int lots = 2, plates = 60;
+    const char *types[] = {"car", "car", "car", "motorcycle", "suv"};
+    filesystem::path dir = filesystem::temp_directory_path() / "pvms_stress_data";
+    filesystem::remove_all(dir);
+    DataStore::root = dir.string();
+    vector<GateTally> tally(lots);
+
+    {
+        ParkingNetwork pn;
+        pn.setDumpInterval(1);
+        for (int l = 1; l <= lots; ++l)
+        {
+            istringstream form("Lot " + to_string(l) + "\nStress\n");
+            ostringstream prompts;
+            streambuf *keyboard = cin.rdbuf(form.rdbuf()), *screen = cout.rdbuf(prompts.rdbuf());
+            pn.addParkingLot();
+            cin.rdbuf(keyboard);
+            cout.rdbuf(screen);
+            ParkingLot *lot = pn.nodes[pn.lookup("L" + to_string(l))];
+            lot->beginBatch();
+            for (int s = 0; s < 24; ++s)
+                lot->addParkingSpot(types[s % 5], "A", 0, s);
+            for (int v = 0; v < plates; ++v)
+                lot->registerVehicle("P" + to_string(v), types[v % 5], "Owner");
+            lot->endBatch();
+        }
+
+        atomic<bool> done{false};
+        thread reader([&]()
+                      {
+                          while (!done)
+                              pn.findNearestAvailable("L1", "car", 2);
+                      });
+        vector<thread> gates;
+        for (int t = 0; t < threads; ++t)
+            gates.emplace_back([&, t]()
+                               {
+                                   mt19937 rng(t + 1);
+                                   for (int i = 0; i < events; ++i)
+                                   {
+                                       int l = rng() % lots;
+                                       string lotId = "L" + to_string(l + 1), plate = "P" + to_string(rng() % plates);
+                                       bool in = rng() % 2;
+                                       string where;
+                                       switch (rng() % 3)
+                                       {
+                                       case 0:
+                                           where = "*";
+                                           break;
+                                       case 1:
+                                           where = to_string(1 + rng() % 24);
+                                           break;
+                                       default:
+                                           where = types[rng() % 5];
+                                       }
+                                       string res = pn.gateEvent(in ? "IN," + lotId + "," + plate + "," + where
+                                                                    : "OUT," + lotId + "," + plate);
+                                       if (res.compare(0, 2, "OK") == 0)
+                                           ++(in ? tally[l].ins : tally[l].outs);
+                                   }
+                               });
+        for (auto &g : gates)
+            g.join();
+        done = true;
+        reader.join();
+
+        for (int l = 0; l < lots; ++l)
+            checkLot(pn.nodes[pn.lookup("L" + to_string(l + 1))], tally[l], "after the run");
+        cout << threads << " thread(s) x " << events << " events:";
+        for (int l = 0; l < lots; ++l)
+            cout << " L" << l + 1 << " " << tally[l].ins << " IN / " << tally[l].outs << " OUT accepted;";
+        cout << "\n";
+    }
+
+    // The background writer drained on destruction; the lots on disk must
+    // satisfy the same invariants.
+    {
+        ParkingNetwork pn;
+        pn.setDumpInterval(0);
+        for (int l = 0; l < lots; ++l)
+            checkLot(pn.nodes[pn.lookup("L" + to_string(l + 1))], tally[l], "after reload");
+    }
+    filesystem::remove_all(dir);
+    cout << (failures ? "FAILED (" + to_string(failures) + ")" : string("OK")) << "\n";
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,142 @@
+// Builds a sharded hospital network of N hospitals (default 100k) laid out
+// as a road grid (each hospital linked to its east and south neighbours,
+// 1-30 km, with one road in ten missing), one in fifty having a "Cardiology" doctor
+// in its registry row. Loads it through Graph, times the routing index
+// build (CSR snapshot and ALT landmarks, paid once per network change),
+// shortestPath() and nearestHospitals() with the specialization filter,
+// which reads registry metadata only and never loads a hospital store.
+// Every route's length is checked against a plain Dijkstra search.
+//
+//   g++ -std=c++17 -O2 -pthread -o routing_bench bench/routing_bench.cpp
+//   ./routing_bench [hospitals] [queries]
+#include <chrono>
+#include <random>
+#define main hospital_main
+#include "../hospital.cpp"
+#undef main
+
+using Clock = chrono::steady_clock;
+
+static double secondsSince(Clock::time_point t0)
+{
+    return chrono::duration<double>(Clock::now() - t0).count();
+}
+
+static string hospitalId(size_t i)
+{
+    return "H" + to_string(i);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n = argc > 1 ? stoul(argv[1]) : 100000;
+    size_t queries = argc > 2 ? stoul(argv[2]) : 200;
+    filesystem::path dir = filesystem::temp_directory_path() / "routing_bench_data";
+    filesystem::remove_all(dir);
+    DataStore::root = dir.string();
+
+    mt19937 rng(42);
+    size_t edges = 0;
+    {
+        DataStore store("hospitals");
+        if (!store.create())
+        {
+            cerr << "Cannot create " << store.path("") << "\n";
+            return 1;
+        }
+        map<int, unique_ptr<CsvWriter>> nodeFiles, edgeFiles;
+        auto writerFor = [&](map<int, unique_ptr<CsvWriter>> &files, int k, const char *file, const char *header)
+        {
+            auto &w = files[k];
+            if (!w)
+            {
+                filesystem::create_directories(store.shardDir(k));
+                w = make_unique<CsvWriter>(store.shardFile(k, file), 4096);
+                w->header(header);
+            }
+            return w.get();
+        };
+        size_t side = (size_t)ceil(sqrt((double)n));
+        uniform_int_distribution<int> km(1, 30), missing(0, 9);
+        for (size_t i = 1; i <= n; ++i)
+        {
+            string id = hospitalId(i);
+            CsvWriter *w = writerFor(nodeFiles, store.shardOf(id), "nodes.csv", "id,name,location,specializations");
+            w->field(id).field("Hospital " + to_string(i)).field("District " + to_string(i % 30));
+            if (i % 50 == 0)
+                w->field("Cardiology");
+            w->endRow();
+            size_t east = i % side ? i + 1 : n + 1, south = i + side;
+            for (size_t j : {east, south})
+            {
+                if (j > n || missing(rng) == 0)
+                    continue;
+                CsvWriter *e = writerFor(edgeFiles, store.shardOf(id), "edges.csv", "from,to,distance");
+                e->field(id).field(hospitalId(j)).field(km(rng));
+                e->endRow();
+                ++edges;
+            }
+        }
+        for (auto *files : {&nodeFiles, &edgeFiles})
+            for (auto &kv : *files)
+                if (!kv.second->commit())
+                {
+                    cerr << "Cannot write shard " << kv.first << "\n";
+                    return 1;
+                }
+    }
+
+    auto t0 = Clock::now();
+    Graph graph;
+    double sLoad = secondsSince(t0);
+    cout << n << " hospitals, " << edges << " edges, loaded in " << sLoad << " s\n";
+
+    t0 = Clock::now();
+    graph.shortestPath(hospitalId(1), hospitalId(1));
+    cout << "routing index built in " << secondsSince(t0) << " s\n";
+
+    uniform_int_distribution<size_t> pick(1, n);
+    vector<pair<string, string>> pairs;
+    for (size_t q = 0; q < queries; ++q)
+        pairs.push_back({hospitalId(pick(rng)), hospitalId(pick(rng))});
+    vector<int64_t> lengths;
+    size_t hops = 0;
+    t0 = Clock::now();
+    for (auto &[a, b] : pairs)
+    {
+        Route r = graph.shortestPath(a, b);
+        hops += r.path.size();
+        lengths.push_back(r.distance);
+    }
+    double sRoute = secondsSince(t0);
+
+    // nearestHospitals() with only the target accepted is plain Dijkstra.
+    size_t wrong = 0;
+    t0 = Clock::now();
+    for (size_t q = 0; q < queries; ++q)
+    {
+        uint32_t dst = graph.lookup(pairs[q].second);
+        auto res = graph.nearestHospitals(pairs[q].first, 1, [&](uint32_t u)
+                                          { return u == dst; });
+        wrong += (res.empty() ? -1 : res[0].second) != lengths[q];
+    }
+    double sDijkstra = secondsSince(t0);
+
+    size_t found = 0;
+    t0 = Clock::now();
+    for (size_t q = 0; q < queries; ++q)
+        found += graph.nearestHospitals(hospitalId(pick(rng)), 5, [&](uint32_t u)
+                                        { return graph.nodes[u]->hasSpecialization("Cardiology"); })
+                     .size();
+    double sNearest = secondsSince(t0);
+
+    size_t loaded = 0;
+    for (auto *h : graph.nodes)
+        loaded += h && h->isLoaded();
+    cout << "shortestPath:      " << sRoute / queries * 1e3 << " ms/query (avg " << hops / queries << " hops)\n";
+    cout << "plain Dijkstra:    " << sDijkstra / queries * 1e3 << " ms/query, " << wrong << " length mismatch(es)\n";
+    cout << "nearestHospitals:  " << sNearest / queries * 1e3 << " ms/query (k=5, " << found << " found)\n";
+    cout << "hospital stores loaded by the queries: " << loaded << "\n";
+    filesystem::remove_all(dir);
+    return 0;
+}
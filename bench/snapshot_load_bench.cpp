@@ -0,0 +1,93 @@
+// Startup cost of one large hospital store, CSV against binary snapshots:
+// writes N patients and N appointments (default 2M each, plus 1000
+// doctors) as CSV, times Hospital::ensureLoaded() on them, converts the
+// store with compact() under Hospital::binarySnapshots, and times the load
+// again from the .bin files.
+//
+//   g++ -std=c++17 -O2 -pthread -o snapshot_load_bench bench/snapshot_load_bench.cpp
+//   ./snapshot_load_bench [rows]
+#include <chrono>
+#define main hospital_main
+#include "../hospital.cpp"
+#undef main
+
+using Clock = chrono::steady_clock;
+
+static double secondsSince(Clock::time_point t0)
+{
+    return chrono::duration<double>(Clock::now() - t0).count();
+}
+
+static double loadSeconds(const string &prefix, size_t &rows)
+{
+    Hospital h("H1", "Bench", "Nowhere");
+    h.storePrefix = prefix;
+    auto t0 = Clock::now();
+    h.ensureLoaded();
+    double s = secondsSince(t0);
+    rows = h.patients.size() + h.doctors.size() + h.appointments.size();
+    return s;
+}
+
+static size_t filesBytes(const string &prefix, const char *ext)
+{
+    size_t total = 0;
+    for (const char *table : {"_patients", "_doctors", "_appointments"})
+        total += filesystem::file_size(prefix + table + ext);
+    return total;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t rows = argc > 1 ? stoul(argv[1]) : 2000000;
+    const int doctors = 1000;
+    filesystem::path dir = filesystem::temp_directory_path() / "snapshot_load_bench_data";
+    filesystem::remove_all(dir);
+    filesystem::create_directories(dir);
+    string prefix = (dir / "H1").string();
+
+    CsvWriter p(prefix + "_patients.csv", rows * 40);
+    p.header("id,name,dob,gender");
+    for (size_t i = 1; i <= rows; ++i)
+    {
+        p.field((int)i).field("Patient " + to_string(i)).field("1990-01-01").field(i % 2 ? "F" : "M");
+        p.endRow();
+    }
+    CsvWriter d(prefix + "_doctors.csv");
+    d.header("id,name,specialization");
+    for (int i = 1; i <= doctors; ++i)
+    {
+        d.field(i).field("Doctor " + to_string(i)).field(i % 3 ? "General" : "Cardiology");
+        d.endRow();
+    }
+    CsvWriter a(prefix + "_appointments.csv", rows * 32);
+    a.header("id,patientId,doctorId,date");
+    for (size_t i = 1; i <= rows; ++i)
+    {
+        a.field((int)i).field((int)(i % rows + 1)).field((int)(i % doctors + 1)).field("2024-05-" + to_string(10 + i % 20));
+        a.endRow();
+    }
+    if (!p.commit() || !d.commit() || !a.commit())
+    {
+        cerr << "Cannot write the CSV store under " << dir << "\n";
+        return 1;
+    }
+
+    size_t csvRows, binRows;
+    double sCsv = loadSeconds(prefix, csvRows);
+    {
+        Hospital h("H1", "Bench", "Nowhere");
+        h.storePrefix = prefix;
+        h.ensureLoaded();
+        Hospital::binarySnapshots = true;
+        h.compact();
+    }
+    double sBin = loadSeconds(prefix, binRows);
+
+    cout << "CSV:    " << csvRows << " rows, " << filesBytes(prefix, ".csv") / (1 << 20) << " MiB, loaded in "
+         << sCsv << " s (" << (size_t)(csvRows / sCsv) << " rows/s)\n";
+    cout << "binary: " << binRows << " rows, " << filesBytes(prefix, ".bin") / (1 << 20) << " MiB, loaded in "
+         << sBin << " s (" << (size_t)(binRows / sBin) << " rows/s)\n";
+    filesystem::remove_all(dir);
+    return 0;
+}
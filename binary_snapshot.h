@@ -0,0 +1,348 @@
+#ifndef BINARY_SNAPSHOT
+#define BINARY_SNAPSHOT
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "csv_io.h"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// ======== Binary Columnar Snapshot ========
+// Layout (little-endian):
+//   header  : "GPTS" | u16 version | u16 columns | u64 rows
+//   column* : u8 type | u8[3] reserved | u32 crc32(payload) | u64 payload bytes
+//             | payload, zero-padded to 8 bytes
+// INT32/INT64 payloads are packed arrays. STRING payloads are (rows + 1) u32
+// offsets followed by the string heap, so field i is heap[off[i], off[i+1]).
+// CSV stays the import/export format; these files exist purely to make
+// restarts cheap.
+
+enum ColumnType : uint8_t
+{
+    COL_INT32 = 1,
+    COL_INT64 = 2,
+    COL_STRING = 3,
+};
+
+const uint16_t SNAPSHOT_VERSION = 1;
+
+// Slicing-by-8: eight bytes per step through eight derived tables, several
+// times faster than the byte-wise loop on large columns.
+inline uint32_t crc32(const char *data, size_t n)
+{
+    static const auto tables = []()
+    {
+        array<array<uint32_t, 256>, 8> t;
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[0][i] = c;
+        }
+        for (uint32_t i = 0; i < 256; ++i)
+            for (int s = 1; s < 8; ++s)
+                t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xFF];
+        return t;
+    }();
+    auto *p = (const uint8_t *)data;
+    uint32_t c = 0xFFFFFFFFu;
+    for (; n >= 8; p += 8, n -= 8)
+    {
+        uint32_t lo = c ^ (p[0] | p[1] << 8 | p[2] << 16 | uint32_t(p[3]) << 24);
+        uint32_t hi = p[4] | p[5] << 8 | p[6] << 16 | uint32_t(p[7]) << 24;
+        c = tables[7][lo & 0xFF] ^ tables[6][(lo >> 8) & 0xFF] ^ tables[5][(lo >> 16) & 0xFF] ^
+            tables[4][lo >> 24] ^ tables[3][hi & 0xFF] ^ tables[2][(hi >> 8) & 0xFF] ^
+            tables[1][(hi >> 16) & 0xFF] ^ tables[0][hi >> 24];
+    }
+    for (; n; ++p, --n)
+        c = tables[0][(c ^ *p) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
+// ======== Snapshot Selection ========
+// A table is stored either as <base>.bin or as <base>.csv. A valid .bin
+// wins on load; a corrupt one is reported and the CSV is read instead. So a
+// CSV save must drop the .bin, or the old snapshot would shadow it.
+struct TableFiles
+{
+    string bin, csv;
+
+    explicit TableFiles(const string &base) : bin(base + ".bin"), csv(base + ".csv") {}
+
+    // Calls loadBin(bin) or loadCsv(csv) following the rule above.
+    template <typename LoadBin, typename LoadCsv>
+    void load(LoadBin loadBin, LoadCsv loadCsv) const
+    {
+        if (filesystem::exists(bin))
+        {
+            if (loadBin(bin))
+                return;
+            cout << "Warning: " << bin << " is corrupt, falling back to CSV\n";
+        }
+        loadCsv(csv);
+    }
+
+    // The file a save in the given format writes, and the one to remove
+    // once it is written (empty when nothing goes stale).
+    const string &target(bool binary) const { return binary ? bin : csv; }
+    string stale(bool binary) const { return binary ? string() : bin; }
+};
+
+// ======== Snapshot Writer ========
+// Rows are appended field by field in schema order, like CsvWriter:
+//   w.i32(p.id).str(p.name); w.endRow();
+class SnapshotWriter
+{
+public:
+    explicit SnapshotWriter(initializer_list<ColumnType> schema)
+    {
+        for (ColumnType t : schema)
+            cols.push_back({t, {}, {0}, {}});
+    }
+
+    SnapshotWriter &i32(int32_t v)
+    {
+        append(next().data, &v, sizeof v);
+        return *this;
+    }
+    SnapshotWriter &i64(int64_t v)
+    {
+        append(next().data, &v, sizeof v);
+        return *this;
+    }
+    SnapshotWriter &str(const string &s)
+    {
+        Column &c = next();
+        c.heap += s;
+        c.offsets.push_back(c.heap.size());
+        return *this;
+    }
+    void endRow()
+    {
+        cursor = 0;
+        ++rows;
+    }
+
+    bool commit(const string &path)
+    {
+        string out = serialize();
+        return writeFileAtomic(path, out.data(), out.size());
+    }
+
+    // The complete file image, for callers that publish it themselves.
+    string serialize()
+    {
+        string out = "GPTS";
+        uint16_t version = SNAPSHOT_VERSION, ncols = cols.size();
+        append(out, &version, sizeof version);
+        append(out, &ncols, sizeof ncols);
+        append(out, &rows, sizeof rows);
+        for (auto &c : cols)
+        {
+            if (c.type == COL_STRING)
+            {
+                c.data.assign((const char *)c.offsets.data(), c.offsets.size() * sizeof(uint32_t));
+                c.data += c.heap;
+            }
+            uint8_t head[4] = {c.type, 0, 0, 0};
+            uint32_t crc = crc32(c.data.data(), c.data.size());
+            uint64_t bytes = c.data.size();
+            out.append((const char *)head, sizeof head);
+            append(out, &crc, sizeof crc);
+            append(out, &bytes, sizeof bytes);
+            out += c.data;
+            out.append((8 - out.size() % 8) % 8, '\0');
+        }
+        return out;
+    }
+
+private:
+    struct Column
+    {
+        ColumnType type;
+        string data;
+        vector<uint32_t> offsets;
+        string heap;
+    };
+    vector<Column> cols;
+    size_t cursor = 0;
+    uint64_t rows = 0;
+
+    Column &next()
+    {
+        return cols[cursor++];
+    }
+    static void append(string &out, const void *p, size_t n)
+    {
+        out.append((const char *)p, n);
+    }
+};
+
+// ======== Snapshot Reader ========
+// Maps the file (read into memory on Windows), verifies header and column
+// checksums, and serves fields straight out of the mapping.
+class SnapshotReader
+{
+public:
+    explicit SnapshotReader(const string &path)
+    {
+        if (!map(path))
+            return;
+        valid = parse();
+    }
+    ~SnapshotReader()
+    {
+#ifndef _WIN32
+        if (mapped)
+            munmap((void *)base, size);
+#endif
+    }
+    SnapshotReader(const SnapshotReader &) = delete;
+    SnapshotReader &operator=(const SnapshotReader &) = delete;
+
+    bool ok() const { return valid; }
+
+    bool matches(initializer_list<ColumnType> schema) const
+    {
+        if (!valid || schema.size() != cols.size())
+            return false;
+        size_t i = 0;
+        for (ColumnType t : schema)
+            if (cols[i++].type != t)
+                return false;
+        return true;
+    }
+
+    uint64_t rows() const { return nrows; }
+
+    int32_t i32(size_t col, uint64_t row) const
+    {
+        int32_t v;
+        memcpy(&v, cols[col].data + row * sizeof v, sizeof v);
+        return v;
+    }
+    int64_t i64(size_t col, uint64_t row) const
+    {
+        int64_t v;
+        memcpy(&v, cols[col].data + row * sizeof v, sizeof v);
+        return v;
+    }
+    string_view str(size_t col, uint64_t row) const
+    {
+        uint32_t b, e;
+        const char *off = cols[col].data;
+        memcpy(&b, off + row * 4, 4);
+        memcpy(&e, off + (row + 1) * 4, 4);
+        const char *heap = off + (nrows + 1) * 4;
+        return string_view(heap + b, e - b);
+    }
+
+private:
+    struct Column
+    {
+        ColumnType type;
+        const char *data;
+    };
+    const char *base = nullptr;
+    size_t size = 0;
+    bool mapped = false, valid = false;
+    string owned; // fallback buffer when mmap is unavailable
+    uint64_t nrows = 0;
+    vector<Column> cols;
+
+    bool map(const string &path)
+    {
+#ifndef _WIN32
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED)
+            {
+                base = (const char *)p;
+                size = st.st_size;
+                mapped = true;
+            }
+        }
+        close(fd);
+        return mapped;
+#else
+        FILE *f = fopen(path.c_str(), "rb");
+        if (!f)
+            return false;
+        char chunk[1 << 16];
+        size_t n;
+        while ((n = fread(chunk, 1, sizeof chunk, f)) > 0)
+            owned.append(chunk, n);
+        fclose(f);
+        base = owned.data();
+        size = owned.size();
+        return size > 0;
+#endif
+    }
+
+    bool parse()
+    {
+        uint16_t version, ncols;
+        if (size < 16 || memcmp(base, "GPTS", 4) != 0)
+            return false;
+        memcpy(&version, base + 4, 2);
+        memcpy(&ncols, base + 6, 2);
+        memcpy(&nrows, base + 8, 8);
+        if (version != SNAPSHOT_VERSION || nrows > size)
+            return false;
+        size_t pos = 16;
+        for (uint16_t i = 0; i < ncols; ++i)
+        {
+            if (pos + 16 > size)
+                return false;
+            ColumnType type = (ColumnType)(uint8_t)base[pos];
+            uint32_t crc;
+            uint64_t bytes;
+            memcpy(&crc, base + pos + 4, 4);
+            memcpy(&bytes, base + pos + 8, 8);
+            pos += 16;
+            if (bytes > size - pos || crc32(base + pos, bytes) != crc)
+                return false;
+            uint64_t need;
+            if (type == COL_INT32)
+                need = nrows * 4;
+            else if (type == COL_INT64)
+                need = nrows * 8;
+            else if (type == COL_STRING)
+                need = (nrows + 1) * 4;
+            else
+                return false;
+            if (bytes < need)
+                return false;
+            if (type == COL_STRING)
+            {
+                uint32_t heapEnd;
+                memcpy(&heapEnd, base + pos + nrows * 4, 4);
+                if (heapEnd > bytes - need)
+                    return false;
+            }
+            cols.push_back({type, base + pos});
+            pos += bytes + (8 - bytes % 8) % 8;
+        }
+        return true;
+    }
+};
+
+#endif
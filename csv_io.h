@@ -0,0 +1,263 @@
+#ifndef CSV_IO
+#define CSV_IO
+
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+#ifdef _WIN32
+#include <io.h> // _commit
+#else
+#include <fcntl.h>  // open
+#include <unistd.h> // fsync
+#endif
+
+using namespace std;
+
+// ======== CSV Reader ========
+// Reads the whole file into one buffer and hands out each row as string_view
+// fields pointing into it, so parsing a row allocates nothing once the field
+// vector has grown. Quoted fields (RFC 4180) are unescaped in place; the
+// views stay valid until the reader is destroyed.
+class CsvReader
+{
+public:
+    explicit CsvReader(const string &fn)
+    {
+        FILE *f = fopen(fn.c_str(), "rb");
+        if (!f)
+            return;
+        opened = true;
+        char chunk[1 << 16];
+        size_t n;
+        while ((n = fread(chunk, 1, sizeof chunk, f)) > 0)
+            buf.append(chunk, n);
+        fclose(f);
+    }
+
+    bool ok() const { return opened; }
+
+    void skipHeader()
+    {
+        vector<string_view> header;
+        next(header);
+    }
+
+    // Fills `fields` with the next non-blank row; returns false at EOF.
+    bool next(vector<string_view> &fields)
+    {
+        fields.clear();
+        while (pos < buf.size() && (buf[pos] == '\n' || buf[pos] == '\r'))
+            ++pos;
+        if (pos >= buf.size())
+            return false;
+        while (true)
+        {
+            fields.push_back(buf[pos] == '"' ? quotedField() : plainField());
+            if (pos < buf.size() && buf[pos] == ',')
+            {
+                ++pos;
+                if (pos >= buf.size())
+                {
+                    fields.push_back({});
+                    break;
+                }
+                continue;
+            }
+            if (pos < buf.size())
+                ++pos; // '\n'
+            break;
+        }
+        return true;
+    }
+
+private:
+    string buf;
+    size_t pos = 0;
+    bool opened = false;
+
+    string_view plainField()
+    {
+        size_t start = pos;
+        while (pos < buf.size() && buf[pos] != ',' && buf[pos] != '\n')
+            ++pos;
+        size_t end = pos;
+        if (end > start && buf[end - 1] == '\r')
+            --end;
+        return string_view(buf.data() + start, end - start);
+    }
+
+    string_view quotedField()
+    {
+        size_t start = ++pos, w = start;
+        while (pos < buf.size())
+        {
+            if (buf[pos] == '"')
+            {
+                if (pos + 1 < buf.size() && buf[pos + 1] == '"')
+                {
+                    buf[w++] = '"';
+                    pos += 2;
+                    continue;
+                }
+                ++pos;
+                break;
+            }
+            buf[w++] = buf[pos++];
+        }
+        // Anything between the closing quote and the delimiter is dropped.
+        while (pos < buf.size() && buf[pos] != ',' && buf[pos] != '\n')
+            ++pos;
+        return string_view(buf.data() + start, w - start);
+    }
+};
+
+// ======== Field Conversion ========
+inline bool parseInt(string_view s, int &out)
+{
+    auto r = from_chars(s.data(), s.data() + s.size(), out);
+    return r.ec == errc() && r.ptr == s.data() + s.size();
+}
+
+inline string toString(string_view s)
+{
+    return string(s.data(), s.size());
+}
+
+// Quotes a field for writing when it contains a delimiter, quote or newline.
+inline string csvEscape(const string &s)
+{
+    if (s.find_first_of(",\"\r\n") == string::npos)
+        return s;
+    string out = "\"";
+    for (char c : s)
+    {
+        if (c == '"')
+            out += '"';
+        out += c;
+    }
+    out += '"';
+    return out;
+}
+
+// ======== Durability ========
+// Force a C stream to disk.
+inline void syncFile(FILE *f)
+{
+    fflush(f);
+#ifdef _WIN32
+    _commit(_fileno(f));
+#else
+    fsync(fileno(f));
+#endif
+}
+
+// Persist a rename in `dir`. Windows has no directory fsync; MoveFileEx
+// (used by filesystem::rename there) is already durable enough.
+inline void syncDir(const filesystem::path &dir)
+{
+#ifndef _WIN32
+    int fd = open(dir.empty() ? "." : dir.c_str(), O_RDONLY);
+    if (fd >= 0)
+    {
+        fsync(fd);
+        close(fd);
+    }
+#else
+    (void)dir;
+#endif
+}
+
+// Publishes `data` as `path` via temp file, fsync, rename and directory
+// fsync, so a crash leaves either the old or the new file.
+inline bool writeFileAtomic(const string &path, const char *data, size_t n)
+{
+    string tmp = path + ".tmp";
+    FILE *f = fopen(tmp.c_str(), "wb");
+    if (!f)
+        return false;
+    bool ok = fwrite(data, 1, n, f) == n;
+    syncFile(f);
+    ok = (fclose(f) == 0) && ok;
+    error_code ec;
+    if (ok)
+        filesystem::rename(tmp, path, ec);
+    if (!ok || ec)
+    {
+        remove(tmp.c_str());
+        return false;
+    }
+    syncDir(filesystem::path(path).parent_path());
+    return true;
+}
+
+// ======== Atomic CSV Writer ========
+// Formats rows into one preallocated buffer and publishes the file with
+// writeFileAtomic(), so a crash never leaves a truncated snapshot.
+class CsvWriter
+{
+public:
+    explicit CsvWriter(const string &fn, size_t reserve = 1 << 16) : path(fn)
+    {
+        buf.reserve(reserve);
+    }
+
+    CsvWriter &header(const char *line)
+    {
+        buf += line;
+        buf += '\n';
+        return *this;
+    }
+
+    CsvWriter &field(const string &s)
+    {
+        separate();
+        if (s.find_first_of(",\"\r\n") == string::npos)
+            buf += s;
+        else
+            buf += csvEscape(s);
+        return *this;
+    }
+
+    CsvWriter &field(int64_t v)
+    {
+        separate();
+        char tmp[24];
+        auto r = to_chars(tmp, tmp + sizeof tmp, v);
+        buf.append(tmp, r.ptr - tmp);
+        return *this;
+    }
+
+    void endRow()
+    {
+        buf += '\n';
+        midRow = false;
+    }
+
+    bool commit()
+    {
+        return writeFileAtomic(path, buf.data(), buf.size());
+    }
+
+    // Hands the formatted file over instead of writing it, for callers that
+    // format under a lock and publish later; the writer is left empty.
+    string release() { return move(buf); }
+
+private:
+    string path, buf;
+    bool midRow = false;
+
+    void separate()
+    {
+        if (midRow)
+            buf += ',';
+        midRow = true;
+    }
+};
+
+#endif
@@ -0,0 +1,169 @@
+#ifndef DATA_STORE
+#define DATA_STORE
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include "csv_io.h"
+
+using namespace std;
+
+// ======== Sharded Data Directory ========
+// Each program keeps its files under <root>/<system>/ (data/hospitals,
+// data/parking) so the two never share a file name. Nodes are grouped into
+// shards of shardSize by the number in their id (H1..H64 -> shard-0000 with
+// the default size). A shard directory holds
+//   nodes.csv  the registry rows of its nodes
+//   edges.csv  edges whose lower-numbered endpoint lives in the shard
+//   <id>_*     the per-node stores
+// The shard size is fixed in <system>/layout.csv when the directory is
+// created, so changing the default never moves existing files.
+class DataStore
+{
+public:
+    static const int DEFAULT_SHARD_SIZE = 64;
+
+    // Root from the DATA_DIR environment variable, else "data". main()
+    // overrides it from --data-dir before any store is constructed.
+    static inline string root = getenv("DATA_DIR") ? getenv("DATA_DIR") : "data";
+
+    explicit DataStore(const string &system) : dir(filesystem::path(root) / system)
+    {
+        CsvReader r((dir / "layout.csv").string());
+        vector<string_view> cols;
+        if (r.ok())
+        {
+            r.skipHeader();
+            int n;
+            if (r.next(cols) && cols.size() >= 1 && parseInt(cols[0], n) && n > 0)
+                shardSize = n;
+            initialized = true;
+        }
+    }
+
+    // False until the directory layout has been written once; callers fall
+    // back to (and migrate) the legacy working-directory files.
+    bool exists() const { return initialized; }
+
+    // Writes layout.csv, after which the directory counts as initialized.
+    // Migrations call it only once every shard is on disk.
+    bool create()
+    {
+        error_code ec;
+        filesystem::create_directories(dir, ec);
+        string layout = "shard_size\n" + to_string(shardSize) + "\n";
+        initialized = writeFileAtomic((dir / "layout.csv").string(), layout.data(), layout.size());
+        return initialized;
+    }
+
+    string path(const string &file) const { return (dir / file).string(); }
+
+    // "H12" -> 12; -1 if the id carries no number.
+    static int nodeNumber(const string &id)
+    {
+        int n;
+        return id.size() > 1 && parseInt(string_view(id).substr(1), n) ? n : -1;
+    }
+
+    int shardOf(const string &id) const { return max(nodeNumber(id), 0) / shardSize; }
+
+    // Shard that stores the edge a-b.
+    int edgeShard(const string &a, const string &b) const
+    {
+        return nodeNumber(a) < nodeNumber(b) ? shardOf(a) : shardOf(b);
+    }
+
+    string shardDir(int shard) const
+    {
+        char name[24];
+        snprintf(name, sizeof name, "shard-%04d", shard);
+        return (dir / name).string();
+    }
+    string shardFile(int shard, const string &file) const { return shardDir(shard) + "/" + file; }
+
+    // Path prefix for a node's store files ("<shard dir>/H12"); creates the
+    // shard directory on first use.
+    string nodePrefix(const string &id) const
+    {
+        string d = shardDir(shardOf(id));
+        error_code ec;
+        filesystem::create_directories(d, ec);
+        return d + "/" + id;
+    }
+
+    // Existing shard numbers, ascending.
+    vector<int> shards() const
+    {
+        vector<int> out;
+        error_code ec;
+        for (auto &e : filesystem::directory_iterator(dir, ec))
+        {
+            string name = e.path().filename().string();
+            int n;
+            if (e.is_directory() && name.rfind("shard-", 0) == 0 && parseInt(string_view(name).substr(6), n))
+                out.push_back(n);
+        }
+        sort(out.begin(), out.end());
+        return out;
+    }
+
+    // Runs fn(i) for i in [0, n) on up to hardware_concurrency threads.
+    // fn must only touch state owned by index i.
+    template <typename F>
+    static void parallelFor(size_t n, F fn)
+    {
+        size_t workers = min<size_t>(n, max(1u, thread::hardware_concurrency()));
+        if (workers <= 1)
+        {
+            for (size_t i = 0; i < n; ++i)
+                fn(i);
+            return;
+        }
+        vector<thread> pool;
+        for (size_t w = 0; w < workers; ++w)
+            pool.emplace_back([&, w]()
+                              {
+                                  for (size_t i = w; i < n; i += workers)
+                                      fn(i);
+                              });
+        for (auto &t : pool)
+            t.join();
+    }
+
+    // Moves legacy "<id>_*" files and directories of the given nodes from the
+    // working directory into their shards. Returns the number moved.
+    int adoptLegacyFiles(const vector<string> &ids) const
+    {
+        unordered_set<string> wanted(ids.begin(), ids.end());
+        vector<pair<string, string>> moves;
+        error_code ec;
+        for (auto &e : filesystem::directory_iterator(".", ec))
+        {
+            string name = e.path().filename().string();
+            size_t cut = name.find('_');
+            if (cut != string::npos && wanted.count(name.substr(0, cut)))
+                moves.push_back({name, nodePrefix(name.substr(0, cut)) + name.substr(cut)});
+        }
+        int moved = 0;
+        for (auto &m : moves)
+        {
+            error_code mv;
+            filesystem::rename(m.first, m.second, mv);
+            if (!mv)
+                ++moved;
+        }
+        return moved;
+    }
+
+private:
+    filesystem::path dir;
+    int shardSize = DEFAULT_SHARD_SIZE;
+    bool initialized = false;
+};
+
+#endif
@@ -8,6 +8,20 @@
 #include <limits>
 #include <algorithm> // std::remove_if
 #include <climits>   // INT_MIN, INT_MAX
+#include <cstdlib>   // getenv
+#include <list>
+#include <queue>
+#include <functional>
+#include <set>
+#include <map>
+#include <array>
+#include <tuple>
+#include <ctime>
+#include <cstdio>    // FILE*, fopen, fflush
+#include "csv_io.h"
+#include "binary_snapshot.h"
+#include "node_index.h"
+#include "data_store.h"
 
 using namespace std;
 
@@ -48,19 +62,16 @@ struct Patient
 {
     int id;
     string name, dob, gender;
-    Patient *next;
 };
 struct Doctor
 {
     int id;
     string name, specialization;
-    Doctor *next;
 };
 struct Appointment
 {
     int id, patientId, doctorId;
     string date;
-    Appointment *next;
 };
 
 // ======== Hospital Class ========
@@ -68,185 +79,635 @@ class Hospital
 {
 public:
     string hospitalId, name, location;
-    Patient *patients = nullptr;
-    Doctor *doctors = nullptr;
-    Appointment *appointments = nullptr;
+    string storePrefix; // path prefix of this hospital's files, set by Graph
+    vector<Patient> patients;
+    vector<Doctor> doctors;
+    vector<Appointment> appointments;
+    // Registry metadata like name and location: kept while the stores are
+    // unloaded, so routing can filter hospitals without loading them.
+    set<string> specializations;
 
     int nextPatientId = 1;
     int nextDoctorId = 1;
     int nextAppointmentId = 1;
 
+    // Mutations are appended to <id>_journal.log; the snapshots are only
+    // rewritten once the journal holds half as many records as the tables
+    // hold rows (at least JOURNAL_COMPACT_MIN), so a registration's share
+    // of the rewrites stays O(1) however large the hospital grows.
+    static const int JOURNAL_SYNC_BATCH = 32;
+    static const int JOURNAL_COMPACT_MIN = 1000;
+
+    // Only metadata is held until the first access; the patient, doctor and
+    // appointment stores are materialized by ensureLoaded() and dropped again
+    // by unload() when the Graph evicts a cold hospital.
     Hospital() = default;
     Hospital(const string &id, const string &nm, const string &loc)
-        : hospitalId(id), name(nm), location(loc)
+        : hospitalId(id), name(nm), location(loc), storePrefix(id)
+    {
+    }
+    ~Hospital()
+    {
+        closeJournal();
+    }
+
+    bool isLoaded() const { return loaded; }
+    void ensureLoaded()
     {
+        if (loaded)
+            return;
         loadData();
-        normalizeCounters();
+        loaded = true;
+    }
+    void unload()
+    {
+        if (!loaded)
+            return;
+        if (journalRecords > 0)
+            compact();
+        closeJournal();
+        patients = {};
+        doctors = {};
+        appointments = {};
+        patientSlot = {};
+        doctorSlot = {};
+        appointmentSlot = {};
+        apptsByDoctor = {};
+        apptsByPatient = {};
+        apptsByDate = {};
+        nextPatientId = nextDoctorId = nextAppointmentId = 1;
+        approxBytes = 0;
+        loaded = false;
+    }
+    // Rough resident size of the loaded stores, used for the cache budget.
+    size_t memoryUsage() const { return approxBytes; }
+
+    bool hasSpecialization(const string &spec) const
+    {
+        return specializations.count(spec) > 0;
     }
 
     int registerPatient(const string &n, const string &d, const string &g)
     {
+        ensureLoaded();
         int id = nextPatientId++;
-        patients = new Patient{id, n, d, g, patients};
-        saveData();
+        addPatient({id, n, d, g});
+        appendJournal("P," + to_string(id) + ',' + csvEscape(n) + ',' + csvEscape(d) + ',' + csvEscape(g));
         return id;
     }
     int registerDoctor(const string &n, const string &spec)
     {
+        ensureLoaded();
         int id = nextDoctorId++;
-        doctors = new Doctor{id, n, spec, doctors};
-        saveData();
+        addDoctor({id, n, spec});
+        appendJournal("D," + to_string(id) + ',' + csvEscape(n) + ',' + csvEscape(spec));
         return id;
     }
     int registerAppointment(int pid, int did, const string &dt)
     {
+        ensureLoaded();
         if (!findPatient(pid) || !findDoctor(did))
             return -1;
         int id = nextAppointmentId++;
-        appointments = new Appointment{id, pid, did, dt, appointments};
-        saveData();
+        addAppointment({id, pid, did, dt});
+        appendJournal("A," + to_string(id) + ',' + to_string(pid) + ',' + to_string(did) + ',' + csvEscape(dt));
         return id;
     }
 
+    // --- Indexed lookups (O(1) by id, O(k) by secondary key) ---
+    Patient *findPatient(int id)
+    {
+        ensureLoaded();
+        auto it = patientSlot.find(id);
+        return it == patientSlot.end() ? nullptr : &patients[it->second];
+    }
+    Doctor *findDoctor(int id)
+    {
+        ensureLoaded();
+        auto it = doctorSlot.find(id);
+        return it == doctorSlot.end() ? nullptr : &doctors[it->second];
+    }
+    Appointment *findAppointment(int id)
+    {
+        ensureLoaded();
+        auto it = appointmentSlot.find(id);
+        return it == appointmentSlot.end() ? nullptr : &appointments[it->second];
+    }
+    const vector<size_t> &appointmentsForDoctor(int did)
+    {
+        ensureLoaded();
+        return slotsFor(apptsByDoctor, did);
+    }
+    const vector<size_t> &appointmentsForPatient(int pid)
+    {
+        ensureLoaded();
+        return slotsFor(apptsByPatient, pid);
+    }
+    const vector<size_t> &appointmentsOn(const string &date)
+    {
+        ensureLoaded();
+        return slotsFor(apptsByDate, date);
+    }
+
     void displayPatients()
     {
+        ensureLoaded();
         cout << "-- Patients in " << name << " (" << hospitalId << ") --\n";
-        for (auto *p = patients; p; p = p->next)
-            cout << p->id << ": " << p->name << " | " << p->dob << " | " << p->gender << "\n";
+        for (auto &p : patients)
+            cout << p.id << ": " << p.name << " | " << p.dob << " | " << p.gender << "\n";
     }
     void displayDoctors()
     {
+        ensureLoaded();
         cout << "-- Doctors in " << name << " (" << hospitalId << ") --\n";
-        for (auto *d = doctors; d; d = d->next)
-            cout << d->id << ": " << d->name << " | " << d->specialization << "\n";
+        for (auto &d : doctors)
+            cout << d.id << ": " << d.name << " | " << d.specialization << "\n";
     }
     void displayAppointments()
     {
+        ensureLoaded();
         cout << "-- Appointments in " << name << " (" << hospitalId << ") --\n";
-        for (auto *a = appointments; a; a = a->next)
-            cout << a->id << ": P" << a->patientId << " → D" << a->doctorId << " on " << a->date << "\n";
+        for (auto &a : appointments)
+            printAppointment(a);
+    }
+    void displayAppointments(const vector<size_t> &slots)
+    {
+        if (slots.empty())
+            cout << "No appointments.\n";
+        for (size_t i : slots)
+            printAppointment(appointments[i]);
     }
 
+    // Snapshot format used by saveData(); see TableFiles for which file a
+    // load picks.
+    static inline bool binarySnapshots = false;
+
     void loadData()
     {
-        loadList<Patient>(hospitalId + "_patients.csv", patients);
-        loadList<Doctor>(hospitalId + "_doctors.csv", doctors);
-        loadList<Appointment>(hospitalId + "_appointments.csv", appointments);
+        loadTable<Patient>(storePrefix + "_patients");
+        loadTable<Doctor>(storePrefix + "_doctors");
+        loadTable<Appointment>(storePrefix + "_appointments");
+        normalizeCounters();
+        replayJournal();
+    }
+    bool saveData()
+    {
+        bool ok = saveTable<Patient>(storePrefix + "_patients");
+        ok = saveTable<Doctor>(storePrefix + "_doctors") && ok;
+        ok = saveTable<Appointment>(storePrefix + "_appointments") && ok;
+        if (!ok)
+            cout << "Warning: could not write data files for " << hospitalId << "\n";
+        return ok;
     }
-    void saveData()
+
+    // Folds the journal back into the CSV snapshots and truncates it. The
+    // journal is kept if the snapshots could not be written.
+    void compact()
     {
-        savePatients(hospitalId + "_patients.csv");
-        saveDoctors(hospitalId + "_doctors.csv");
-        saveAppointments(hospitalId + "_appointments.csv");
+        if (!saveData())
+            return;
+        closeJournal();
+        if (FILE *f = fopen(journalFile().c_str(), "wb"))
+            fclose(f);
+        journalRecords = 0;
     }
 
 private:
-    Patient *findPatient(int id)
+    bool loaded = false;
+    size_t approxBytes = 0;
+    unordered_map<int, size_t> patientSlot, doctorSlot, appointmentSlot;
+    unordered_map<int, vector<size_t>> apptsByDoctor, apptsByPatient;
+    unordered_map<string, vector<size_t>> apptsByDate;
+
+    template <typename K>
+    static const vector<size_t> &slotsFor(const unordered_map<K, vector<size_t>> &idx, const K &key)
     {
-        for (auto *p = patients; p; p = p->next)
-            if (p->id == id)
-                return p;
-        return nullptr;
+        static const vector<size_t> none;
+        auto it = idx.find(key);
+        return it == idx.end() ? none : it->second;
     }
-    Doctor *findDoctor(int id)
+
+    void addPatient(Patient p)
+    {
+        approxBytes += sizeof(Patient) + p.name.size() + p.dob.size() + p.gender.size() + 32;
+        patientSlot[p.id] = patients.size();
+        patients.push_back(move(p));
+    }
+    void addDoctor(Doctor d)
+    {
+        approxBytes += sizeof(Doctor) + d.name.size() + d.specialization.size() + 32;
+        doctorSlot[d.id] = doctors.size();
+        specializations.insert(d.specialization);
+        doctors.push_back(move(d));
+    }
+    void addAppointment(Appointment a)
     {
-        for (auto *d = doctors; d; d = d->next)
-            if (d->id == id)
-                return d;
-        return nullptr;
+        approxBytes += sizeof(Appointment) + a.date.size() + 96;
+        size_t slot = appointments.size();
+        appointmentSlot[a.id] = slot;
+        apptsByDoctor[a.doctorId].push_back(slot);
+        apptsByPatient[a.patientId].push_back(slot);
+        apptsByDate[a.date].push_back(slot);
+        appointments.push_back(move(a));
+    }
+    void printAppointment(const Appointment &a)
+    {
+        cout << a.id << ": P" << a.patientId << " → D" << a.doctorId << " on " << a.date << "\n";
+    }
+
+    FILE *journal = nullptr;
+    int journalRecords = 0;
+    int unsyncedRecords = 0;
+
+    string journalFile() const
+    {
+        return storePrefix + "_journal.log";
+    }
+
+    void appendJournal(const string &record)
+    {
+        if (!journal)
+            journal = fopen(journalFile().c_str(), "ab");
+        if (!journal)
+        {
+            saveData(); // journal unavailable: fall back to a full snapshot
+            return;
+        }
+        fputs(record.c_str(), journal);
+        fputc('\n', journal);
+        fflush(journal);
+        ++journalRecords;
+        if (++unsyncedRecords >= JOURNAL_SYNC_BATCH)
+        {
+            syncFile(journal);
+            unsyncedRecords = 0;
+        }
+        size_t rows = patients.size() + doctors.size() + appointments.size();
+        if ((size_t)journalRecords >= max<size_t>(JOURNAL_COMPACT_MIN, rows / 2))
+            compact();
+    }
+    void closeJournal()
+    {
+        if (!journal)
+            return;
+        syncFile(journal);
+        fclose(journal);
+        journal = nullptr;
+        unsyncedRecords = 0;
+    }
+
+    // Re-applies journal records on top of the snapshot. Records whose id is
+    // already covered by the snapshot (compaction interrupted before the
+    // truncate) are skipped, so replay is idempotent.
+    void replayJournal()
+    {
+        CsvReader r(journalFile());
+        vector<string_view> cols;
+        while (r.next(cols))
+        {
+            ++journalRecords;
+            // A torn trailing record from a crash fails the id parse and is ignored.
+            int id;
+            if (cols.size() < 4 || !parseInt(cols[1], id))
+                continue;
+            if (cols[0] == "P" && cols.size() >= 5)
+            {
+                if (id < nextPatientId)
+                    continue;
+                addPatient({id, toString(cols[2]), toString(cols[3]), toString(cols[4])});
+                nextPatientId = id + 1;
+            }
+            else if (cols[0] == "D")
+            {
+                if (id < nextDoctorId)
+                    continue;
+                addDoctor({id, toString(cols[2]), toString(cols[3])});
+                nextDoctorId = id + 1;
+            }
+            else if (cols[0] == "A" && cols.size() >= 5)
+            {
+                int pid, did;
+                if (id < nextAppointmentId || !parseInt(cols[2], pid) || !parseInt(cols[3], did))
+                    continue;
+                addAppointment({id, pid, did, toString(cols[4])});
+                nextAppointmentId = id + 1;
+            }
+        }
     }
 
     template <typename T>
-    void loadList(const string &fn, T *&head)
+    void loadTable(const string &base)
     {
-        ifstream f(fn);
-        if (!f)
+        TableFiles(base).load([&](const string &fn)
+                              { return loadBinary<T>(fn); },
+                              [&](const string &fn)
+                              { loadList<T>(fn); });
+    }
+    template <typename T>
+    bool saveTable(const string &base)
+    {
+        TableFiles files(base);
+        const string &path = files.target(binarySnapshots);
+        bool ok;
+        if (binarySnapshots)
+            ok = saveBinary<T>(path);
+        else if constexpr (is_same<T, Patient>::value)
+            ok = savePatients(path);
+        else if constexpr (is_same<T, Doctor>::value)
+            ok = saveDoctors(path);
+        else
+            ok = saveAppointments(path);
+        string stale = files.stale(binarySnapshots);
+        if (ok && !stale.empty())
+            remove(stale.c_str());
+        return ok;
+    }
+
+    template <typename T>
+    bool loadBinary(const string &fn)
+    {
+        SnapshotReader r(fn);
+        if constexpr (is_same<T, Patient>::value)
+        {
+            if (!r.matches({COL_INT32, COL_STRING, COL_STRING, COL_STRING}))
+                return false;
+            patients.reserve(r.rows());
+            for (uint64_t i = 0; i < r.rows(); ++i)
+                addPatient({r.i32(0, i), toString(r.str(1, i)), toString(r.str(2, i)), toString(r.str(3, i))});
+        }
+        else if constexpr (is_same<T, Doctor>::value)
+        {
+            if (!r.matches({COL_INT32, COL_STRING, COL_STRING}))
+                return false;
+            doctors.reserve(r.rows());
+            for (uint64_t i = 0; i < r.rows(); ++i)
+                addDoctor({r.i32(0, i), toString(r.str(1, i)), toString(r.str(2, i))});
+        }
+        else
+        {
+            if (!r.matches({COL_INT32, COL_INT32, COL_INT32, COL_STRING}))
+                return false;
+            appointments.reserve(r.rows());
+            for (uint64_t i = 0; i < r.rows(); ++i)
+                addAppointment({r.i32(0, i), r.i32(1, i), r.i32(2, i), toString(r.str(3, i))});
+        }
+        return true;
+    }
+    template <typename T>
+    bool saveBinary(const string &fn)
+    {
+        if constexpr (is_same<T, Patient>::value)
+        {
+            SnapshotWriter w({COL_INT32, COL_STRING, COL_STRING, COL_STRING});
+            for (auto &p : patients)
+            {
+                w.i32(p.id).str(p.name).str(p.dob).str(p.gender);
+                w.endRow();
+            }
+            return w.commit(fn);
+        }
+        else if constexpr (is_same<T, Doctor>::value)
+        {
+            SnapshotWriter w({COL_INT32, COL_STRING, COL_STRING});
+            for (auto &d : doctors)
+            {
+                w.i32(d.id).str(d.name).str(d.specialization);
+                w.endRow();
+            }
+            return w.commit(fn);
+        }
+        else
+        {
+            SnapshotWriter w({COL_INT32, COL_INT32, COL_INT32, COL_STRING});
+            for (auto &a : appointments)
+            {
+                w.i32(a.id).i32(a.patientId).i32(a.doctorId).str(a.date);
+                w.endRow();
+            }
+            return w.commit(fn);
+        }
+    }
+
+    template <typename T>
+    void loadList(const string &fn)
+    {
+        CsvReader r(fn);
+        if (!r.ok())
             return;
-        string line;
-        getline(f, line);
-        while (getline(f, line))
-        {
-            stringstream ss(line);
-            vector<string> cols;
-            string tok;
-            while (getline(ss, tok, ','))
-                cols.push_back(tok);
+        r.skipHeader();
+        vector<string_view> cols;
+        int id;
+        while (r.next(cols))
+        {
+            if (cols.size() < 3 || !parseInt(cols[0], id))
+                continue;
             if constexpr (is_same<T, Patient>::value)
             {
-                head = new Patient{stoi(cols[0]), cols[1], cols[2], cols[3], head};
+                if (cols.size() >= 4)
+                    addPatient({id, toString(cols[1]), toString(cols[2]), toString(cols[3])});
             }
             else if constexpr (is_same<T, Doctor>::value)
             {
-                head = new Doctor{stoi(cols[0]), cols[1], cols[2], head};
+                addDoctor({id, toString(cols[1]), toString(cols[2])});
             }
             else
             {
-                head = new Appointment{stoi(cols[0]), stoi(cols[1]), stoi(cols[2]), cols[3], head};
+                int pid, did;
+                if (cols.size() >= 4 && parseInt(cols[1], pid) && parseInt(cols[2], did))
+                    addAppointment({id, pid, did, toString(cols[3])});
             }
         }
     }
 
-    void savePatients(const string &fn)
+    bool savePatients(const string &fn)
     {
-        ofstream f(fn);
-        f << "id,name,dob,gender\n";
-        for (auto *p = patients; p; p = p->next)
-            f << p->id << ',' << p->name << ',' << p->dob << ',' << p->gender << "\n";
+        CsvWriter w(fn, patients.size() * 48 + 64);
+        w.header("id,name,dob,gender");
+        for (auto &p : patients)
+        {
+            w.field(p.id).field(p.name).field(p.dob).field(p.gender);
+            w.endRow();
+        }
+        return w.commit();
     }
-    void saveDoctors(const string &fn)
+    bool saveDoctors(const string &fn)
     {
-        ofstream f(fn);
-        f << "id,name,specialization\n";
-        for (auto *d = doctors; d; d = d->next)
-            f << d->id << ',' << d->name << ',' << d->specialization << "\n";
+        CsvWriter w(fn, doctors.size() * 40 + 64);
+        w.header("id,name,specialization");
+        for (auto &d : doctors)
+        {
+            w.field(d.id).field(d.name).field(d.specialization);
+            w.endRow();
+        }
+        return w.commit();
     }
-    void saveAppointments(const string &fn)
+    bool saveAppointments(const string &fn)
     {
-        ofstream f(fn);
-        f << "id,patientId,doctorId,date\n";
-        for (auto *a = appointments; a; a = a->next)
-            f << a->id << ',' << a->patientId << ',' << a->doctorId << ',' << a->date << "\n";
+        CsvWriter w(fn, appointments.size() * 32 + 64);
+        w.header("id,patientId,doctorId,date");
+        for (auto &a : appointments)
+        {
+            w.field(a.id).field(a.patientId).field(a.doctorId).field(a.date);
+            w.endRow();
+        }
+        return w.commit();
     }
 
     void normalizeCounters()
     {
-        for (auto *p = patients; p; p = p->next)
-            nextPatientId = max(nextPatientId, p->id + 1);
-        for (auto *d = doctors; d; d = d->next)
-            nextDoctorId = max(nextDoctorId, d->id + 1);
-        for (auto *a = appointments; a; a = a->next)
-            nextAppointmentId = max(nextAppointmentId, a->id + 1);
+        for (auto &p : patients)
+            nextPatientId = max(nextPatientId, p.id + 1);
+        for (auto &d : doctors)
+            nextDoctorId = max(nextDoctorId, d.id + 1);
+        for (auto &a : appointments)
+            nextAppointmentId = max(nextAppointmentId, a.id + 1);
     }
 };
 
+// ======== Routing Results ========
+struct Route
+{
+    int64_t distance = -1; // km; -1 when unreachable
+    vector<string> path;
+};
+
 // ======== Graph Class with Full CRUD on Connections ========
+// Hospitals are addressed by interned node ids internally; the "H<n>" string
+// ids only appear at the menu and file boundary.
 class Graph
 {
+public:
+    NodeInterner ids;
+    vector<Hospital *> nodes; // indexed by node id, nullptr for free slots
+    Adjacency adj;
+    int nextHospitalIndex = 1;
 
-private:
-    bool areConnected(const string &a, const string &b)
+    // Memory budget for loaded hospital stores; least recently managed
+    // hospitals are unloaded once it is exceeded. Override with the
+    // HOSPITAL_CACHE_MB environment variable.
+    size_t cacheBudgetBytes = 64u << 20;
+
+    Graph()
     {
-        if (adj.find(a) == adj.end())
-            return false;
-        for (const auto &edge : adj[a])
+        if (const char *mb = getenv("HOSPITAL_CACHE_MB"))
         {
-            if (edge.first == b)
+            try
             {
-                return true;
+                cacheBudgetBytes = (size_t)stoul(mb) << 20;
             }
+            catch (...)
+            {
+                cout << "Ignoring invalid HOSPITAL_CACHE_MB.\n";
+            }
+        }
+        if (store.exists())
+        {
+            loadShards();
+            replayNetworkJournal(store.path(NETWORK_JOURNAL));
+        }
+        else
+            migrateLegacy();
+        if (specializationsMissing)
+        {
+            backfillSpecializations();
+            compactNetwork();
         }
-        return false;
+    }
+    ~Graph()
+    {
+        flush();
+        for (auto *h : nodes)
+            delete h;
     }
 
-public:
-    unordered_map<string, Hospital *> nodes;
-    unordered_map<string, vector<pair<string, int>>> adj;
-    int nextHospitalIndex = 1;
+    // --- Persistence ---
+    // Network edits are coalesced in dirty sets and written as delta records
+    // to network_journal.log by flush(), which runs every FLUSH_INTERVAL_SEC
+    // (polled through tick() from both menus), at exit, and before a
+    // hospital's stores are written: a new hospital's H record and a new
+    // specialization's S record are on disk before the first store record
+    // that depends on them. The shards' nodes.csv and edges.csv are only
+    // rewritten when the journal is compacted. Record kinds: H/h hospital
+    // upsert/delete, S specialization gained, E/e edge upsert/delete.
+    static const int FLUSH_INTERVAL_SEC = 5;
+    static const int NETWORK_COMPACT_THRESHOLD = 5000;
 
-    Graph()
+    void tick()
     {
-        loadHospitals();
-        loadConnections();
+        if (time(nullptr) - lastFlush >= FLUSH_INTERVAL_SEC)
+            flush();
+    }
+    void flush()
+    {
+        lastFlush = time(nullptr);
+        if (dirtyHospitals.empty() && dirtyEdges.empty() && newSpecializations.empty())
+            return;
+        FILE *f = fopen(store.path(NETWORK_JOURNAL).c_str(), "ab");
+        if (!f)
+        {
+            compactNetwork(); // journal unavailable: fall back to full snapshots
+            return;
+        }
+        for (auto &id : dirtyHospitals)
+        {
+            uint32_t u = lookup(id);
+            if (u == NO_NODE)
+                fprintf(f, "h,%s\n", id.c_str());
+            else
+                fprintf(f, "H,%s,%s,%s\n", id.c_str(), csvEscape(nodes[u]->name).c_str(),
+                        csvEscape(nodes[u]->location).c_str());
+            ++networkJournalRecords;
+        }
+        for (auto &[id, spec] : newSpecializations)
+        {
+            if (lookup(id) == NO_NODE)
+                continue;
+            fprintf(f, "S,%s,%s\n", id.c_str(), csvEscape(spec).c_str());
+            ++networkJournalRecords;
+        }
+        for (auto &e : dirtyEdges)
+        {
+            uint32_t u = lookup(e.first), v = lookup(e.second);
+            // Edges of a deleted hospital are dropped by its "h" record.
+            if (u == NO_NODE || v == NO_NODE)
+                continue;
+            int32_t w;
+            if (adj.weight(u, v, w))
+                fprintf(f, "E,%s,%s,%d\n", e.first.c_str(), e.second.c_str(), (int)w);
+            else
+                fprintf(f, "e,%s,%s\n", e.first.c_str(), e.second.c_str());
+            ++networkJournalRecords;
+        }
+        syncFile(f);
+        fclose(f);
+        dirtyHospitals.clear();
+        newSpecializations.clear();
+        dirtyEdges.clear();
+        if (networkJournalRecords >= NETWORK_COMPACT_THRESHOLD)
+            compactNetwork();
+    }
+
+    // Rewrites every hospital's snapshot in the current format
+    // (Hospital::binarySnapshots), folding in its journal.
+    void convertSnapshots()
+    {
+        for (auto *h : nodes)
+        {
+            if (!h)
+                continue;
+            bool resident = h->isLoaded();
+            h->ensureLoaded();
+            h->compact();
+            if (!resident)
+                h->unload();
+            cout << "Converted " << h->hospitalId << "\n";
+        }
+    }
+
+    // Resolves an external hospital id; NO_NODE if it does not exist.
+    uint32_t lookup(const string &id) const
+    {
+        return ids.find(id);
     }
 
     // --- Node operations ---
@@ -259,9 +720,8 @@ public:
         string loc;
         getline(cin, loc);
         string id = genId();
-        nodes[id] = new Hospital(id, nm, loc);
-        saveHospitals();
-        saveConnections();
+        insertHospital(new Hospital(id, nm, loc));
+        markHospital(id);
         cout << "Added: " << id << "\n";
     }
     void deleteHospital()
@@ -269,24 +729,19 @@ public:
         cout << "Hospital ID to delete: ";
         string id;
         getline(cin, id);
-        if (!nodes.count(id))
+        uint32_t u = lookup(id);
+        if (u == NO_NODE)
         {
             cout << "Not found.\n";
             return;
         }
-        delete nodes[id];
-        nodes.erase(id);
-        adj.erase(id);
-        for (auto &kv : adj)
-        {
-            auto &v = kv.second;
-            v.erase(remove_if(v.begin(), v.end(),
-                              [&](auto &p)
-                              { return p.first == id; }),
-                    v.end());
-        }
-        saveHospitals();
-        saveConnections();
+        forgetLoaded(u);
+        delete nodes[u];
+        nodes[u] = nullptr;
+        adj.removeNode(u);
+        ids.release(u);
+        routingDirty = true;
+        markHospital(id);
         cout << "Deleted " << id << "\n";
     }
     void updateHospitalInfo()
@@ -294,7 +749,8 @@ public:
         cout << "Hospital ID: ";
         string id;
         getline(cin, id);
-        if (!nodes.count(id))
+        uint32_t u = lookup(id);
+        if (u == NO_NODE)
         {
             cout << "Not found.\n";
             return;
@@ -306,10 +762,10 @@ public:
         string loc;
         getline(cin, loc);
         if (!nm.empty())
-            nodes[id]->name = nm;
+            nodes[u]->name = nm;
         if (!loc.empty())
-            nodes[id]->location = loc;
-        saveHospitals();
+            nodes[u]->location = loc;
+        markHospital(id);
         cout << "Updated " << id << "\n";
     }
 
@@ -322,82 +778,191 @@ public:
         cout << "To ID:   ";
         string b;
         getline(cin, b);
-        if (!nodes.count(a) || !nodes.count(b))
-        {
-            cout << "Invalid IDs.\n";
-            return;
-        }
-        if (areConnected(a, b))
-        {
-            cout << "Hospitals are already connected.\n";
-            return;
-        }
-        int dist = readInt("Distance (km): ", 0);
-        adj[a].push_back({b, dist});
-        adj[b].push_back({a, dist});
-        saveConnections();
-        cout << "Connected " << a << " <-> " << b << "\n";
+        if (connect(a, b))
+            cout << "Connected " << a << " <-> " << b << "\n";
     }
     void updateConnection(const string &a, const string &b)
     {
-        if (!nodes.count(a) || !nodes.count(b))
+        uint32_t u = lookup(a), v = lookup(b);
+        if (u == NO_NODE || v == NO_NODE)
         {
             cout << "Invalid IDs.\n";
             return;
         }
-        auto &va = adj[a], &vb = adj[b];
-        int idxA = -1, idxB = -1;
-        for (int i = 0; i < va.size(); ++i)
-            if (va[i].first == b)
-                idxA = i;
-        for (int i = 0; i < vb.size(); ++i)
-            if (vb[i].first == a)
-                idxB = i;
-        if (idxA < 0 || idxB < 0)
+        if (!adj.connected(u, v))
         {
             cout << "No connection found.\n";
             return;
         }
         int nd = readInt("New distance (km): ", 0);
-        va[idxA].second = vb[idxB].second = nd;
-        saveConnections();
+        adj.setWeight(u, v, nd);
+        markEdge(u, v);
         cout << "Updated " << a << "<->" << b << " to " << nd << "km\n";
     }
     void deleteConnection(const string &a, const string &b)
     {
-        if (!nodes.count(a) || !nodes.count(b))
+        uint32_t u = lookup(a), v = lookup(b);
+        if (u == NO_NODE || v == NO_NODE)
         {
             cout << "Invalid IDs.\n";
             return;
         }
-        auto &va = adj[a], &vb = adj[b];
-        va.erase(remove_if(va.begin(), va.end(),
-                           [&](auto &p)
-                           { return p.first == b; }),
-                 va.end());
-        vb.erase(remove_if(vb.begin(), vb.end(),
-                           [&](auto &p)
-                           { return p.first == a; }),
-                 vb.end());
-        saveConnections();
+        adj.disconnect(u, v);
+        markEdge(u, v);
         cout << "Removed connection " << a << " <-> " << b << "\n";
     }
 
+    // Bulk-loads from,to,distance rows: new pairs are connected, existing
+    // ones get the new distance. Only the touched edges are journaled.
+    void importConnections(const string &fn)
+    {
+        CsvReader r(fn);
+        if (!r.ok())
+        {
+            cout << "Cannot open " << fn << "\n";
+            return;
+        }
+        r.skipHeader();
+        vector<string_view> cols;
+        int added = 0, updated = 0, skipped = 0;
+        while (r.next(cols))
+        {
+            int d;
+            uint32_t u = NO_NODE, v = NO_NODE;
+            if (cols.size() >= 3 && parseInt(cols[2], d) && d >= 0)
+            {
+                u = lookup(toString(cols[0]));
+                v = lookup(toString(cols[1]));
+            }
+            if (u == NO_NODE || v == NO_NODE || u == v)
+                ++skipped;
+            else
+            {
+                if (adj.connect(u, v, d))
+                    ++added;
+                else if (adj.setWeight(u, v, d))
+                    ++updated;
+                markEdge(u, v);
+            }
+        }
+        flush();
+        cout << "Imported " << added << " new, " << updated << " updated, "
+             << skipped << " skipped.\n";
+    }
+    void importConnections()
+    {
+        cout << "CSV file (from,to,distance): ";
+        string fn;
+        getline(cin, fn);
+        importConnections(fn);
+    }
+
     // --- Display ---
     void listHospitals()
     {
         cout << "-- Hospitals --\n";
-        for (auto &kv : nodes)
-            cout << kv.first << " | " << kv.second->name << " | " << kv.second->location << "\n";
+        for (auto *h : nodes)
+            if (h)
+                cout << h->hospitalId << " | " << h->name << " | " << h->location << "\n";
     }
+
+    // --- Routing ---
+    // Searches run over a CSR snapshot of adj, rebuilt lazily after any node
+    // or connection change together with the landmark distances below.
+    // shortestPath() is A* with the landmark (ALT) lower bound, so it only
+    // settles nodes close to the shortest path; nearestHospitals() has no
+    // target and stays plain Dijkstra.
+    Route shortestPath(const string &from, const string &to)
+    {
+        Route r;
+        uint32_t src = lookup(from), dst = lookup(to);
+        if (src == NO_NODE || dst == NO_NODE)
+            return r;
+        buildRoutingIndex();
+        runSearch(src, [&](uint32_t u)
+                  { return u == dst; },
+                  dst);
+        if (distOf(dst) == INT64_MAX)
+            return r;
+        r.distance = distOf(dst);
+        for (uint32_t u = dst; u != NO_NODE; u = parent[u])
+            r.path.push_back(ids.name(u));
+        reverse(r.path.begin(), r.path.end());
+        return r;
+    }
+    // The k closest hospitals (by road distance, including `from` itself)
+    // that satisfy `pred`, nearest first.
+    vector<pair<string, int64_t>> nearestHospitals(const string &from, int k,
+                                                   const function<bool(uint32_t)> &pred)
+    {
+        vector<pair<string, int64_t>> found;
+        uint32_t src = lookup(from);
+        if (src == NO_NODE || k <= 0)
+            return found;
+        buildRoutingIndex();
+        runSearch(src, [&](uint32_t u)
+                  {
+                      if (pred(u))
+                          found.push_back({ids.name(u), dist[u]});
+                      return (int)found.size() >= k; });
+        return found;
+    }
+
+    void showShortestRoute()
+    {
+        cout << "From ID: ";
+        string a;
+        getline(cin, a);
+        cout << "To ID:   ";
+        string b;
+        getline(cin, b);
+        if (lookup(a) == NO_NODE || lookup(b) == NO_NODE)
+        {
+            cout << "Invalid IDs.\n";
+            return;
+        }
+        Route r = shortestPath(a, b);
+        if (r.distance < 0)
+        {
+            cout << "No route between " << a << " and " << b << ".\n";
+            return;
+        }
+        for (size_t i = 0; i < r.path.size(); ++i)
+            cout << (i ? " -> " : "") << r.path[i];
+        cout << " (" << r.distance << "km)\n";
+    }
+    void showNearestHospitals()
+    {
+        cout << "From ID: ";
+        string from;
+        getline(cin, from);
+        if (lookup(from) == NO_NODE)
+        {
+            cout << "Not found.\n";
+            return;
+        }
+        cout << "Required specialization (blank=any): ";
+        string spec;
+        getline(cin, spec);
+        int k = readInt("How many: ", 1);
+        auto res = nearestHospitals(from, k, [&](uint32_t u)
+                                    { return spec.empty() || nodes[u]->hasSpecialization(spec); });
+        if (res.empty())
+            cout << "No matching hospital reachable.\n";
+        for (auto &kv : res)
+            cout << kv.first << " | " << nodes[lookup(kv.first)]->name << " | " << kv.second << "km\n";
+    }
+
     void displayNetwork()
     {
         cout << "-- Network --\n";
-        for (auto &kv : adj)
+        for (uint32_t u = 0; u < nodes.size(); ++u)
         {
-            cout << kv.first << " -> ";
-            for (auto &e : kv.second)
-                cout << e.first << "(" << e.second << "km) ";
+            if (!nodes[u] || adj.neighbours(u).empty())
+                continue;
+            cout << ids.name(u) << " -> ";
+            for (auto &e : adj.neighbours(u))
+                cout << ids.name(e.to) << "(" << e.w << "km) ";
             cout << "\n";
         }
     }
@@ -408,12 +973,15 @@ public:
         cout << "Hospital ID: ";
         string hid;
         getline(cin, hid);
-        if (!nodes.count(hid))
+        uint32_t hu = lookup(hid);
+        if (hu == NO_NODE)
         {
             cout << "Not found.\n";
             return;
         }
-        Hospital *h = nodes[hid];
+        if (dirtyHospitals.count(hid))
+            flush();
+        Hospital *h = acquire(hu);
         while (true)
         {
             cout << "\n-- Managing " << h->name << " (" << hid << ") --\n"
@@ -427,9 +995,13 @@ public:
                  << "8. Add Connection\n"
                  << "9. Update Connection\n"
                  << "10.Delete Connection\n"
-                 << "11.Go Back\n";
-            int c = readInt("Choose: ", 1, 11);
-            if (c == 11)
+                 << "11.Appointments by Doctor\n"
+                 << "12.Appointments by Patient\n"
+                 << "13.Appointments on Date\n"
+                 << "14.Go Back\n";
+            int c = readInt("Choose: ", 1, 14);
+            tick();
+            if (c == 14)
                 break;
             switch (c)
             {
@@ -455,6 +1027,12 @@ public:
                 cout << "Spec: ";
                 string s;
                 getline(cin, s);
+                if (!h->hasSpecialization(s))
+                {
+                    h->specializations.insert(s);
+                    newSpecializations.insert({hid, s});
+                    flush();
+                }
                 cout << "Added Doctor " << h->registerDoctor(n, s) << "\n";
                 break;
             }
@@ -480,8 +1058,8 @@ public:
             case 7:
             {
                 cout << "-- Connections from " << hid << " --\n";
-                for (auto &e : adj[hid])
-                    cout << e.first << "(" << e.second << "km)\n";
+                for (auto &e : adj.neighbours(hu))
+                    cout << ids.name(e.to) << "(" << e.w << "km)\n";
                 break;
             }
             case 8:
@@ -489,21 +1067,8 @@ public:
                 cout << "Connect to ID: ";
                 string other;
                 getline(cin, other);
-                if (!nodes.count(other))
-                {
-                    cout << "Invalid ID.\n";
-                    break;
-                }
-                if (areConnected(hid, other))
-                {
-                    cout << "Hospitals are already connected.\n";
-                    break;
-                }
-                int dist = readInt("Distance (km): ", 0);
-                adj[hid].push_back({other, dist});
-                adj[other].push_back({hid, dist});
-                saveConnections();
-                cout << "Connected.\n";
+                if (connect(hid, other))
+                    cout << "Connected.\n";
                 break;
             }
             case 9:
@@ -522,90 +1087,611 @@ public:
                 deleteConnection(hid, other);
                 break;
             }
+            case 11:
+            {
+                int did = readInt("Doctor ID: ", 1);
+                h->displayAppointments(h->appointmentsForDoctor(did));
+                break;
+            }
+            case 12:
+            {
+                int pid = readInt("Patient ID: ", 1);
+                h->displayAppointments(h->appointmentsForPatient(pid));
+                break;
+            }
+            case 13:
+            {
+                cout << "Date: ";
+                string dt;
+                getline(cin, dt);
+                h->displayAppointments(h->appointmentsOn(dt));
+                break;
+            }
             }
         }
     }
 
 private:
-    string genId()
+    static constexpr const char *NETWORK_JOURNAL = "network_journal.log";
+    DataStore store{"hospitals"};
+    set<string> dirtyHospitals;
+    set<pair<string, string>> newSpecializations; // (hospital id, specialization)
+    set<pair<string, string>> dirtyEdges;
+    int networkJournalRecords = 0;
+    time_t lastFlush = time(nullptr);
+
+    void markHospital(const string &id)
     {
-        return "H" + to_string(nextHospitalIndex++);
+        dirtyHospitals.insert(id);
+    }
+    void markEdge(uint32_t u, uint32_t v)
+    {
+        routingDirty = true;
+        const string &a = ids.name(u), &b = ids.name(v);
+        dirtyEdges.insert(a < b ? make_pair(a, b) : make_pair(b, a));
     }
 
-    // -- hospitals.csv --
-    void loadHospitals()
+    bool compactNetwork()
     {
-        ifstream f("hospitals.csv");
-        if (!f)
-            return;
-        string line;
-        getline(f, line);
-        int maxIdx = 0;
-        while (getline(f, line))
+        if (!saveShards())
         {
-            stringstream ss(line);
-            string id, nm, loc;
-            getline(ss, id, ',');
-            getline(ss, nm, ',');
-            getline(ss, loc, ',');
-            maxIdx = max(maxIdx, stoi(id.substr(1)));
-            nodes[id] = new Hospital(id, nm, loc);
+            cout << "Warning: could not write the hospital network shards\n";
+            return false;
         }
-        nextHospitalIndex = maxIdx + 1;
+        if (FILE *f = fopen(store.path(NETWORK_JOURNAL).c_str(), "wb"))
+            fclose(f);
+        networkJournalRecords = 0;
+        dirtyHospitals.clear();
+        newSpecializations.clear();
+        dirtyEdges.clear();
+        return true;
     }
-    void saveHospitals()
+
+    void replayNetworkJournal(const string &fn)
     {
-        ofstream f("hospitals.csv");
-        f << "id,name,location\n";
-        for (auto &kv : nodes)
-            f << kv.first << ',' << kv.second->name << ',' << kv.second->location << "\n";
+        CsvReader r(fn);
+        vector<string_view> cols;
+        while (r.next(cols))
+        {
+            ++networkJournalRecords;
+            if (cols.size() < 2)
+                continue;
+            string id = toString(cols[1]);
+            uint32_t u = lookup(id);
+            if (cols[0] == "H" && cols.size() >= 4)
+            {
+                int idx;
+                if (!parseInt(cols[1].substr(1), idx))
+                    continue;
+                nextHospitalIndex = max(nextHospitalIndex, idx + 1);
+                if (u == NO_NODE)
+                    insertHospital(new Hospital(id, toString(cols[2]), toString(cols[3])));
+                else
+                {
+                    nodes[u]->name = toString(cols[2]);
+                    nodes[u]->location = toString(cols[3]);
+                }
+            }
+            else if (cols[0] == "S" && cols.size() >= 3 && u != NO_NODE)
+                nodes[u]->specializations.insert(toString(cols[2]));
+            else if (cols[0] == "h" && u != NO_NODE)
+            {
+                delete nodes[u];
+                nodes[u] = nullptr;
+                adj.removeNode(u);
+                ids.release(u);
+            }
+            else if ((cols[0] == "E" || cols[0] == "e") && cols.size() >= 3)
+            {
+                uint32_t v = lookup(toString(cols[2]));
+                int d;
+                if (u == NO_NODE || v == NO_NODE)
+                    continue;
+                if (cols[0] == "e")
+                    adj.disconnect(u, v);
+                else if (cols.size() >= 4 && parseInt(cols[3], d) && !adj.connect(u, v, d))
+                    adj.setWeight(u, v, d);
+            }
+        }
     }
 
-    // -- connections.csv --
-    void loadConnections()
+    // CSR snapshot of adj used by the routing queries.
+    bool routingDirty = true;
+    vector<uint32_t> rowStart, colIdx;
+    vector<int> weight;
+
+    // Per-node search scratch. An entry is only valid while its stamp
+    // equals searchGen, so a search pays for the nodes it reaches, not for
+    // every slot. Distances are int64_t: edge weights are int, path sums
+    // can exceed it.
+    vector<int64_t> dist, estimate; // estimate: lowerBound() to the target
+    vector<uint32_t> parent, searchStamp;
+    uint32_t searchGen = 0;
+    vector<tuple<int64_t, int64_t, uint32_t>> frontier; // (key, distance, node) heap
+
+    // ALT landmarks: exact distances from a few spread-out hospitals to
+    // every node. By the triangle inequality |d(L,t) - d(L,v)| never
+    // exceeds d(v,t), so the largest of them is an admissible, consistent
+    // A* estimate. Picked farthest-first within the component of a
+    // well-connected hospital, so they sit on the edges of the network where
+    // the bounds are tightest. Stored node-major (landmarkDist[v *
+    // landmarks + k]) so one bound reads one cache line.
+    static const int ROUTING_LANDMARKS = 16;
+    int landmarks = 0;
+    vector<int64_t> landmarkDist;
+
+    int64_t distOf(uint32_t u) const
     {
-        ifstream f("connections.csv");
-        if (!f)
+        return searchStamp[u] == searchGen ? dist[u] : INT64_MAX;
+    }
+
+    // Lower bound on the distance from v to t; INT64_MAX if a landmark
+    // shows they are in different components.
+    int64_t lowerBound(uint32_t v, uint32_t t) const
+    {
+        const int64_t *dv = &landmarkDist[(size_t)v * landmarks], *dt = &landmarkDist[(size_t)t * landmarks];
+        int64_t best = 0;
+        for (int k = 0; k < landmarks; ++k)
+        {
+            // A node the landmarks' component does not reach is INT64_MAX
+            // for all of them.
+            if (dv[k] == INT64_MAX || dt[k] == INT64_MAX)
+                return dv[k] == dt[k] ? 0 : INT64_MAX;
+            best = max(best, dt[k] > dv[k] ? dt[k] - dv[k] : dv[k] - dt[k]);
+        }
+        return best;
+    }
+
+    void buildRoutingIndex()
+    {
+        if (!routingDirty)
             return;
-        string line;
-        getline(f, line);
-        while (getline(f, line))
+        uint32_t n = ids.slots();
+        rowStart.assign(n + 1, 0);
+        colIdx.clear();
+        weight.clear();
+        for (uint32_t u = 0; u < n; ++u)
         {
-            stringstream ss(line);
-            string a, b;
-            int d;
-            getline(ss, a, ',');
-            getline(ss, b, ',');
-            ss >> d;
-            if (nodes.count(a) && nodes.count(b))
+            for (auto &e : adj.neighbours(u))
             {
-                adj[a].push_back({b, d});
-                adj[b].push_back({a, d});
+                colIdx.push_back(e.to);
+                weight.push_back(e.w);
             }
+            rowStart[u + 1] = colIdx.size();
+        }
+        if (searchStamp.size() != n)
+        {
+            dist.assign(n, 0);
+            estimate.assign(n, 0);
+            parent.assign(n, NO_NODE);
+            searchStamp.assign(n, 0);
+            searchGen = 0;
         }
+        routingDirty = false;
+        buildLandmarks();
     }
-    void saveConnections()
+
+    // One full search per landmark, plus one to find the first.
+    void buildLandmarks()
     {
-        ofstream f("connections.csv");
-        f << "from,to,distance\n";
-        for (auto &kv : adj)
+        landmarks = 0;
+        landmarkDist.clear();
+        uint32_t n = ids.slots();
+        uint32_t start = NO_NODE;
+        size_t degree = 0;
+        for (uint32_t u = 0; u < n; ++u)
+            if (nodes[u] && rowStart[u + 1] - rowStart[u] > degree)
+            {
+                degree = rowStart[u + 1] - rowStart[u];
+                start = u;
+            }
+        if (start == NO_NODE)
+            return;
+        vector<int64_t> nearest(n, INT64_MAX); // to the closest landmark so far
+        vector<vector<int64_t>> found;
+        runSearch(start, [](uint32_t) { return false; });
+        for (int k = 0; k < ROUTING_LANDMARKS; ++k)
         {
-            const string &a = kv.first;
-            for (auto &e : kv.second)
+            // The reachable node farthest from the landmarks so far (from
+            // `start` for the first).
+            uint32_t pick = NO_NODE;
+            int64_t far = 0;
+            for (uint32_t u = 0; u < n; ++u)
             {
-                const string &b = e.first;
-                int d = e.second;
-                if (a < b)
-                    f << a << ',' << b << ',' << d << "\n";
+                int64_t d = k == 0 ? distOf(u) : nearest[u];
+                if (d != INT64_MAX && d > far)
+                {
+                    far = d;
+                    pick = u;
+                }
+            }
+            if (pick == NO_NODE)
+                break;
+            runSearch(pick, [](uint32_t) { return false; });
+            found.emplace_back(n);
+            for (uint32_t u = 0; u < n; ++u)
+            {
+                found.back()[u] = distOf(u);
+                nearest[u] = min(nearest[u], distOf(u));
             }
         }
+        landmarks = found.size();
+        landmarkDist.resize((size_t)n * landmarks);
+        for (uint32_t u = 0; u < n; ++u)
+            for (int k = 0; k < landmarks; ++k)
+                landmarkDist[(size_t)u * landmarks + k] = found[k][u];
+    }
+
+    // Settles nodes in distance order from src until `settled` returns true.
+    // With a target, nodes are ordered by distance plus lowerBound() to it
+    // (A*); since the bound is consistent each node still settles at its
+    // exact distance.
+    void runSearch(uint32_t src, const function<bool(uint32_t)> &settled, uint32_t target = NO_NODE)
+    {
+        if (++searchGen == 0) // wrapped: stale stamps could match again
+        {
+            fill(searchStamp.begin(), searchStamp.end(), 0);
+            searchGen = 1;
+        }
+        auto byKey = greater<tuple<int64_t, int64_t, uint32_t>>();
+        // Stamps v as reached and works out its estimate, once per search.
+        auto reach = [&](uint32_t v)
+        {
+            searchStamp[v] = searchGen;
+            estimate[v] = target == NO_NODE ? 0 : lowerBound(v, target);
+        };
+        frontier.clear();
+        reach(src);
+        dist[src] = 0;
+        parent[src] = NO_NODE;
+        frontier.push_back({estimate[src], 0, src});
+        while (!frontier.empty())
+        {
+            pop_heap(frontier.begin(), frontier.end(), byKey);
+            auto [key, d, u] = frontier.back();
+            frontier.pop_back();
+            if (d > dist[u])
+                continue;
+            if (settled(u))
+                return;
+            for (uint32_t i = rowStart[u]; i < rowStart[u + 1]; ++i)
+            {
+                uint32_t v = colIdx[i];
+                int64_t nd = d + weight[i];
+                if (searchStamp[v] != searchGen)
+                    reach(v);
+                else if (nd >= dist[v])
+                    continue;
+                dist[v] = nd;
+                parent[v] = u;
+                if (estimate[v] == INT64_MAX)
+                    continue;
+                frontier.push_back({nd + estimate[v], nd, v});
+                push_heap(frontier.begin(), frontier.end(), byKey);
+            }
+        }
+    }
+
+    // Loaded hospitals, most recently used at the front.
+    list<uint32_t> lru;
+    unordered_map<uint32_t, list<uint32_t>::iterator> lruPos;
+
+    Hospital *acquire(uint32_t u)
+    {
+        Hospital *h = nodes[u];
+        h->ensureLoaded();
+        auto it = lruPos.find(u);
+        if (it != lruPos.end())
+            lru.erase(it->second);
+        lru.push_front(u);
+        lruPos[u] = lru.begin();
+        evictCold();
+        return h;
+    }
+    void evictCold()
+    {
+        size_t used = 0;
+        for (uint32_t u : lru)
+            used += nodes[u]->memoryUsage();
+        // Never evict the hospital that was just touched.
+        while (used > cacheBudgetBytes && lru.size() > 1)
+        {
+            Hospital *cold = nodes[lru.back()];
+            used -= cold->memoryUsage();
+            cold->unload();
+            lruPos.erase(lru.back());
+            lru.pop_back();
+        }
+    }
+    void forgetLoaded(uint32_t u)
+    {
+        auto it = lruPos.find(u);
+        if (it == lruPos.end())
+            return;
+        lru.erase(it->second);
+        lruPos.erase(it);
+    }
+
+    string genId()
+    {
+        return "H" + to_string(nextHospitalIndex++);
+    }
+
+    void insertHospital(Hospital *h)
+    {
+        uint32_t u = ids.intern(h->hospitalId);
+        if (u >= nodes.size())
+            nodes.resize(u + 1, nullptr);
+        nodes[u] = h;
+        if (store.exists())
+            h->storePrefix = store.nodePrefix(h->hospitalId);
+    }
+
+    bool connect(const string &a, const string &b)
+    {
+        uint32_t u = lookup(a), v = lookup(b);
+        if (u == NO_NODE || v == NO_NODE)
+        {
+            cout << "Invalid IDs.\n";
+            return false;
+        }
+        if (u == v)
+        {
+            cout << "Cannot connect a hospital to itself.\n";
+            return false;
+        }
+        if (adj.connected(u, v))
+        {
+            cout << "Hospitals are already connected.\n";
+            return false;
+        }
+        int dist = readInt("Distance (km): ", 0);
+        adj.connect(u, v, dist);
+        markEdge(u, v);
+        return true;
+    }
+
+    // -- Sharded network files (see DataStore) --
+    void loadShards()
+    {
+        struct HospitalRow
+        {
+            string id, name, location;
+            vector<string> specializations;
+        };
+        struct ShardRows
+        {
+            vector<HospitalRow> hospitals;
+            vector<tuple<string, string, int>> edges;
+            bool noSpecializations = false;
+        };
+        vector<int> shards = store.shards();
+        vector<ShardRows> rows(shards.size());
+        // Parsing runs per shard in parallel; interning stays on this thread.
+        DataStore::parallelFor(shards.size(), [&](size_t i)
+                               {
+                                   vector<string_view> cols;
+                                   CsvReader n(store.shardFile(shards[i], "nodes.csv"));
+                                   if (n.next(cols))
+                                       rows[i].noSpecializations = cols.size() < 4;
+                                   while (n.next(cols))
+                                   {
+                                       if (cols.size() < 3)
+                                           continue;
+                                       HospitalRow h{toString(cols[0]), toString(cols[1]), toString(cols[2]), {}};
+                                       for (size_t c = 3; c < cols.size(); ++c)
+                                           h.specializations.push_back(toString(cols[c]));
+                                       rows[i].hospitals.push_back(move(h));
+                                   }
+                                   CsvReader e(store.shardFile(shards[i], "edges.csv"));
+                                   e.skipHeader();
+                                   int d;
+                                   while (e.next(cols))
+                                       if (cols.size() >= 3 && parseInt(cols[2], d))
+                                           rows[i].edges.emplace_back(toString(cols[0]), toString(cols[1]), d);
+                               });
+        for (auto &shard : rows)
+        {
+            specializationsMissing |= shard.noSpecializations;
+            for (auto &h : shard.hospitals)
+            {
+                int idx = DataStore::nodeNumber(h.id);
+                if (idx < 0)
+                    continue;
+                nextHospitalIndex = max(nextHospitalIndex, idx + 1);
+                auto *hospital = new Hospital(h.id, h.name, h.location);
+                hospital->specializations.insert(h.specializations.begin(), h.specializations.end());
+                insertHospital(hospital);
+            }
+        }
+        for (auto &shard : rows)
+            for (auto &[a, b, d] : shard.edges)
+            {
+                uint32_t u = lookup(a), v = lookup(b);
+                if (u != NO_NODE && v != NO_NODE)
+                    adj.connect(u, v, d);
+            }
+    }
+
+    // nodes.csv rows list the specializations of a hospital's doctors after
+    // its location, one per column, so routing can filter on them without
+    // loading the hospital. Registries written before that column existed
+    // are filled in once by loading every hospital.
+    bool specializationsMissing = false;
+
+    void backfillSpecializations()
+    {
+        vector<Hospital *> hs;
+        for (auto *h : nodes)
+            if (h)
+                hs.push_back(h);
+        DataStore::parallelFor(hs.size(), [&](size_t i)
+                               {
+                                   bool resident = hs[i]->isLoaded();
+                                   hs[i]->ensureLoaded();
+                                   if (!resident)
+                                       hs[i]->unload();
+                               });
+        specializationsMissing = false;
+    }
+
+    // Rewrites nodes.csv and edges.csv of every shard, in parallel.
+    bool saveShards()
+    {
+        map<int, vector<Hospital *>> byShard;
+        map<int, vector<pair<uint32_t, Edge>>> edgesByShard;
+        for (int k : store.shards())
+            byShard[k]; // emptied shards still get rewritten
+        for (auto *h : nodes)
+            if (h)
+                byShard[store.shardOf(h->hospitalId)].push_back(h);
+        for (uint32_t u = 0; u < adj.size(); ++u)
+            for (auto &e : adj.neighbours(u))
+                if (u < e.to)
+                    edgesByShard[store.edgeShard(ids.name(u), ids.name(e.to))].push_back({u, e});
+        vector<int> shards;
+        for (auto &kv : byShard)
+            shards.push_back(kv.first);
+        for (auto &kv : edgesByShard)
+            if (!byShard.count(kv.first))
+                shards.push_back(kv.first);
+        vector<char> ok(shards.size(), 0);
+        DataStore::parallelFor(shards.size(), [&](size_t i)
+                               {
+                                   int k = shards[i];
+                                   error_code ec;
+                                   filesystem::create_directories(store.shardDir(k), ec);
+                                   CsvWriter n(store.shardFile(k, "nodes.csv"));
+                                   n.header("id,name,location,specializations");
+                                   auto hs = byShard.find(k);
+                                   if (hs != byShard.end())
+                                       for (auto *h : hs->second)
+                                       {
+                                           n.field(h->hospitalId).field(h->name).field(h->location);
+                                           for (auto &spec : h->specializations)
+                                               n.field(spec);
+                                           n.endRow();
+                                       }
+                                   CsvWriter e(store.shardFile(k, "edges.csv"));
+                                   e.header("from,to,distance");
+                                   auto es = edgesByShard.find(k);
+                                   if (es != edgesByShard.end())
+                                       for (auto &[u, edge] : es->second)
+                                       {
+                                           e.field(ids.name(u)).field(ids.name(edge.to)).field(edge.w);
+                                           e.endRow();
+                                       }
+                                   ok[i] = n.commit() && e.commit();
+                               });
+        return all_of(ok.begin(), ok.end(), [](char c)
+                      { return c != 0; });
+    }
+
+    // First run against a data directory: pick up the pre-sharding files
+    // (hospitals.csv, connections.csv, network_journal.log and the <id>_*
+    // stores in the working directory), move the stores into their shards
+    // and write the sharded network. connections.csv may be shared with
+    // pvms, so the legacy network files are left in place; only edges
+    // between known hospitals are taken. layout.csv is written last and the
+    // legacy journal only removed after it: until then the next start
+    // migrates again, replaying whatever this attempt journaled too.
+    void migrateLegacy()
+    {
+        specializationsMissing = true;
+        loadLegacyHospitals("hospitals.csv");
+        loadLegacyConnections("connections.csv");
+        replayNetworkJournal(NETWORK_JOURNAL);
+        replayNetworkJournal(store.path(NETWORK_JOURNAL));
+        vector<string> known;
+        for (auto *h : nodes)
+            if (h)
+            {
+                known.push_back(h->hospitalId);
+                h->storePrefix = store.nodePrefix(h->hospitalId);
+            }
+        int moved = store.adoptLegacyFiles(known);
+        backfillSpecializations();
+        networkJournalRecords = 0;
+        if (!compactNetwork() || !store.create())
+        {
+            cout << "Warning: could not write " << store.path("") << "; the migration will be retried\n";
+            return;
+        }
+        remove(NETWORK_JOURNAL);
+        if (!known.empty())
+            cout << "Migrated " << known.size() << " hospital(s) and " << moved
+                 << " store file(s) into " << store.path("") << "\n";
+    }
+
+    void loadLegacyHospitals(const string &fn)
+    {
+        CsvReader r(fn);
+        if (!r.ok())
+            return;
+        r.skipHeader();
+        vector<string_view> cols;
+        while (r.next(cols))
+        {
+            int idx;
+            if (cols.size() < 3 || !parseInt(cols[0].substr(1), idx))
+                continue;
+            nextHospitalIndex = max(nextHospitalIndex, idx + 1);
+            insertHospital(new Hospital(toString(cols[0]), toString(cols[1]), toString(cols[2])));
+        }
+    }
+    void loadLegacyConnections(const string &fn)
+    {
+        CsvReader r(fn);
+        if (!r.ok())
+            return;
+        r.skipHeader();
+        vector<string_view> cols;
+        while (r.next(cols))
+        {
+            int d;
+            if (cols.size() < 3 || !parseInt(cols[2], d))
+                continue;
+            uint32_t u = lookup(toString(cols[0])), v = lookup(toString(cols[1]));
+            if (u != NO_NODE && v != NO_NODE)
+                adj.connect(u, v, d);
+        }
     }
 };
 
 // ======== Main ========
-int main()
+int main(int argc, char *argv[])
 {
+    // --binary          save hospital stores as binary snapshots this session
+    // --convert FORMAT  rewrite all stores as FORMAT (binary|csv) and exit
+    // --data-dir DIR    data root (default $DATA_DIR, else "data")
+    string convertTo;
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg == "--binary")
+            Hospital::binarySnapshots = true;
+        else if (arg == "--data-dir" && i + 1 < argc)
+            DataStore::root = argv[++i];
+        else if (arg == "--convert" && i + 1 < argc)
+            convertTo = argv[++i];
+        else
+        {
+            cout << "Usage: " << argv[0] << " [--binary] [--data-dir DIR] [--convert binary|csv]\n";
+            return 1;
+        }
+    }
     Graph graph;
+    if (!convertTo.empty())
+    {
+        if (convertTo != "binary" && convertTo != "csv")
+        {
+            cout << "Unknown format: " << convertTo << "\n";
+            return 1;
+        }
+        Hospital::binarySnapshots = convertTo == "binary";
+        graph.convertSnapshots();
+        return 0;
+    }
     while (true)
     {
         cout << "\n=== Multi-Hospital Management ===\n"
@@ -616,9 +1702,12 @@ int main()
              << "5. List Hospitals\n"
              << "6. View Network\n"
              << "7. Manage Hospital\n"
-             << "8. Exit\n";
-        int choice = readInt("Choose: ", 1, 8);
-        if (choice == 8)
+             << "8. Shortest Route\n"
+             << "9. Nearest Hospitals\n"
+             << "10.Import Connections\n"
+             << "11.Exit\n";
+        int choice = readInt("Choose: ", 1, 11);
+        if (choice == 11)
             break;
         switch (choice)
         {
@@ -643,7 +1732,17 @@ int main()
         case 7:
             graph.manageHospital();
             break;
+        case 8:
+            graph.showShortestRoute();
+            break;
+        case 9:
+            graph.showNearestHospitals();
+            break;
+        case 10:
+            graph.importConnections();
+            break;
         }
+        graph.tick();
     }
     cout << "Goodbye!\n";
     return 0;
@@ -0,0 +1,195 @@
+#ifndef NODE_INDEX
+#define NODE_INDEX
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+const uint32_t NO_NODE = UINT32_MAX;
+
+struct Edge
+{
+    uint32_t to;
+    int32_t w;
+};
+
+// ======== Node Interner ========
+// Maps external string ids ("H12", "L7") to dense uint32 slots so adjacency
+// and traversal never hash or store strings. Slots of removed nodes are
+// recycled by later intern() calls.
+class NodeInterner
+{
+public:
+    uint32_t intern(const string &name)
+    {
+        auto it = index.find(name);
+        if (it != index.end())
+            return it->second;
+        uint32_t id;
+        if (!freeSlots.empty())
+        {
+            id = freeSlots.back();
+            freeSlots.pop_back();
+            names[id] = name;
+        }
+        else
+        {
+            id = names.size();
+            names.push_back(name);
+        }
+        index[name] = id;
+        return id;
+    }
+
+    uint32_t find(const string &name) const
+    {
+        auto it = index.find(name);
+        return it == index.end() ? NO_NODE : it->second;
+    }
+
+    const string &name(uint32_t id) const { return names[id]; }
+
+    bool alive(uint32_t id) const { return id < names.size() && !names[id].empty(); }
+
+    void release(uint32_t id)
+    {
+        if (!alive(id))
+            return;
+        index.erase(names[id]);
+        names[id].clear();
+        freeSlots.push_back(id);
+    }
+
+    // Upper bound on ids handed out so far (including released slots).
+    uint32_t slots() const { return names.size(); }
+
+private:
+    unordered_map<string, uint32_t> index;
+    vector<string> names;
+    vector<uint32_t> freeSlots;
+};
+
+// ======== Undirected Weighted Adjacency ========
+// Each undirected edge lives in both endpoints' lists. A packed edge index
+// keyed on the ordered id pair records its position in each list, so
+// existence checks, weight updates and deletes are O(1) regardless of degree.
+class Adjacency
+{
+public:
+    const vector<Edge> &neighbours(uint32_t u) const
+    {
+        static const vector<Edge> none;
+        return u < lists.size() ? lists[u] : none;
+    }
+
+    bool connected(uint32_t a, uint32_t b) const
+    {
+        return index.count(key(a, b)) > 0;
+    }
+
+    // Adds a–b; returns false for self-loops or if the edge already exists.
+    bool connect(uint32_t a, uint32_t b, int32_t w)
+    {
+        if (a == b)
+            return false;
+        auto [it, added] = index.try_emplace(key(a, b));
+        if (!added)
+            return false;
+        grow(max(a, b));
+        lists[a].push_back({b, w});
+        lists[b].push_back({a, w});
+        slot(it->second, a, b) = lists[a].size() - 1;
+        slot(it->second, b, a) = lists[b].size() - 1;
+        return true;
+    }
+
+    bool weight(uint32_t a, uint32_t b, int32_t &w) const
+    {
+        auto it = index.find(key(a, b));
+        if (it == index.end())
+            return false;
+        w = lists[a][a < b ? it->second.lo : it->second.hi].w;
+        return true;
+    }
+
+    bool setWeight(uint32_t a, uint32_t b, int32_t w)
+    {
+        auto it = index.find(key(a, b));
+        if (it == index.end())
+            return false;
+        lists[a][slot(it->second, a, b)].w = w;
+        lists[b][slot(it->second, b, a)].w = w;
+        return true;
+    }
+
+    bool disconnect(uint32_t a, uint32_t b)
+    {
+        auto it = index.find(key(a, b));
+        if (it == index.end())
+            return false;
+        EdgePos pos = it->second;
+        index.erase(it);
+        removeAt(a, slot(pos, a, b));
+        removeAt(b, slot(pos, b, a));
+        return true;
+    }
+
+    // Drops every edge of u, touching only u's neighbours.
+    void removeNode(uint32_t u)
+    {
+        if (u >= lists.size())
+            return;
+        while (!lists[u].empty())
+            disconnect(u, lists[u].back().to);
+    }
+
+    uint32_t size() const { return lists.size(); }
+
+private:
+    // Position of the edge in the lower id's list and in the higher id's list.
+    struct EdgePos
+    {
+        uint32_t lo, hi;
+    };
+
+    vector<vector<Edge>> lists;
+    unordered_map<uint64_t, EdgePos> index;
+
+    static uint64_t key(uint32_t a, uint32_t b)
+    {
+        if (a > b)
+            swap(a, b);
+        return (uint64_t)a << 32 | b;
+    }
+
+    // Position of edge (owner, other) inside lists[owner].
+    static uint32_t &slot(EdgePos &p, uint32_t owner, uint32_t other)
+    {
+        return owner < other ? p.lo : p.hi;
+    }
+
+    void grow(uint32_t u)
+    {
+        if (u >= lists.size())
+            lists.resize(u + 1);
+    }
+
+    // Swap-and-pop lists[owner][i], re-pointing the index entry of the edge
+    // that moved into slot i.
+    void removeAt(uint32_t owner, uint32_t i)
+    {
+        auto &v = lists[owner];
+        if (i + 1 != v.size())
+        {
+            v[i] = v.back();
+            slot(index[key(owner, v[i].to)], owner, v[i].to) = i;
+        }
+        v.pop_back();
+    }
+};
+
+#endif
@@ -0,0 +1,247 @@
+#ifndef PASSWORD_HASH
+#define PASSWORD_HASH
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <string_view>
+#include "csv_io.h"
+
+using namespace std;
+
+// ======== SHA-256 ========
+// FIPS 180-4. Only what PBKDF2 needs: streaming update and a 32-byte digest.
+class Sha256
+{
+public:
+    static const size_t DIGEST = 32, BLOCK = 64;
+
+    Sha256() { reset(); }
+
+    void reset()
+    {
+        static const uint32_t init[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                         0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+        memcpy(h, init, sizeof h);
+        used = 0;
+        length = 0;
+    }
+
+    void update(const void *data, size_t n)
+    {
+        auto *p = (const uint8_t *)data;
+        length += n;
+        if (used)
+        {
+            size_t take = min(n, BLOCK - used);
+            memcpy(buf + used, p, take);
+            used += take;
+            p += take;
+            n -= take;
+            if (used < BLOCK)
+                return;
+            compress(buf);
+            used = 0;
+        }
+        for (; n >= BLOCK; p += BLOCK, n -= BLOCK)
+            compress(p);
+        memcpy(buf, p, n);
+        used = n;
+    }
+
+    void final(uint8_t out[DIGEST])
+    {
+        uint64_t bits = length * 8;
+        uint8_t pad = 0x80;
+        update(&pad, 1);
+        pad = 0;
+        while (used != BLOCK - 8)
+            update(&pad, 1);
+        uint8_t len[8];
+        for (int i = 0; i < 8; ++i)
+            len[i] = uint8_t(bits >> (56 - 8 * i));
+        update(len, 8);
+        for (int i = 0; i < 8; ++i)
+            for (int k = 0; k < 4; ++k)
+                out[4 * i + k] = uint8_t(h[i] >> (24 - 8 * k));
+    }
+
+private:
+    uint32_t h[8];
+    uint8_t buf[BLOCK];
+    size_t used;
+    uint64_t length;
+
+    static uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+    void compress(const uint8_t *block)
+    {
+        static const uint32_t k[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+        uint32_t w[64];
+        for (int i = 0; i < 16; ++i)
+            w[i] = uint32_t(block[4 * i]) << 24 | uint32_t(block[4 * i + 1]) << 16 |
+                   uint32_t(block[4 * i + 2]) << 8 | block[4 * i + 3];
+        for (int i = 16; i < 64; ++i)
+        {
+            uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+        for (int i = 0; i < 64; ++i)
+        {
+            uint32_t t1 = hh + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+            uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            hh = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        h[0] += a, h[1] += b, h[2] += c, h[3] += d;
+        h[4] += e, h[5] += f, h[6] += g, h[7] += hh;
+    }
+};
+
+// ======== PBKDF2-HMAC-SHA256 ========
+// RFC 8018 with a single 32-byte output block. The HMAC key pads are hashed
+// once and their states copied per iteration, so each iteration costs two
+// compressions.
+inline void pbkdf2Sha256(string_view password, string_view salt, uint32_t iterations,
+                         uint8_t out[Sha256::DIGEST])
+{
+    uint8_t key[Sha256::BLOCK] = {};
+    if (password.size() > Sha256::BLOCK)
+    {
+        Sha256 kh;
+        kh.update(password.data(), password.size());
+        kh.final(key);
+    }
+    else
+        memcpy(key, password.data(), password.size());
+    uint8_t ipad[Sha256::BLOCK], opad[Sha256::BLOCK];
+    for (size_t i = 0; i < Sha256::BLOCK; ++i)
+    {
+        ipad[i] = key[i] ^ 0x36;
+        opad[i] = key[i] ^ 0x5c;
+    }
+    Sha256 inner, outer;
+    inner.update(ipad, sizeof ipad);
+    outer.update(opad, sizeof opad);
+
+    auto hmac = [&](const uint8_t *msg, size_t n, const uint8_t *tail, size_t tn, uint8_t mac[Sha256::DIGEST])
+    {
+        Sha256 in = inner, out = outer;
+        in.update(msg, n);
+        if (tn)
+            in.update(tail, tn);
+        in.final(mac);
+        out.update(mac, Sha256::DIGEST);
+        out.final(mac);
+    };
+
+    const uint8_t blockIndex[4] = {0, 0, 0, 1};
+    uint8_t u[Sha256::DIGEST];
+    hmac((const uint8_t *)salt.data(), salt.size(), blockIndex, 4, u);
+    memcpy(out, u, sizeof u);
+    for (uint32_t i = 1; i < iterations; ++i)
+    {
+        hmac(u, sizeof u, nullptr, 0, u);
+        for (size_t k = 0; k < sizeof u; ++k)
+            out[k] ^= u[k];
+    }
+}
+
+// ======== Stored Password Hashes ========
+// Stored form: pbkdf2-sha256$<iterations>$<salt hex>$<hash hex>. The
+// iteration count travels with each hash, so raising PASSWORD_ITERATIONS
+// only affects passwords set afterwards.
+const uint32_t PASSWORD_ITERATIONS = 100000;
+const size_t PASSWORD_SALT_BYTES = 16;
+
+inline string toHex(const uint8_t *p, size_t n)
+{
+    static const char digits[] = "0123456789abcdef";
+    string out(2 * n, '0');
+    for (size_t i = 0; i < n; ++i)
+    {
+        out[2 * i] = digits[p[i] >> 4];
+        out[2 * i + 1] = digits[p[i] & 15];
+    }
+    return out;
+}
+
+inline bool fromHex(string_view s, string &out)
+{
+    auto val = [](char c)
+    {
+        return c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+    };
+    if (s.size() % 2)
+        return false;
+    out.clear();
+    for (size_t i = 0; i < s.size(); i += 2)
+    {
+        int hi = val(s[i]), lo = val(s[i + 1]);
+        if (hi < 0 || lo < 0)
+            return false;
+        out += char(hi << 4 | lo);
+    }
+    return true;
+}
+
+// Compares in time that depends only on the lengths.
+inline bool constantTimeEquals(string_view a, string_view b)
+{
+    if (a.size() != b.size())
+        return false;
+    uint8_t diff = 0;
+    for (size_t i = 0; i < a.size(); ++i)
+        diff |= uint8_t(a[i] ^ b[i]);
+    return diff == 0;
+}
+
+inline string hashPassword(string_view password, uint32_t iterations = PASSWORD_ITERATIONS)
+{
+    random_device rd;
+    uint8_t salt[PASSWORD_SALT_BYTES];
+    for (auto &b : salt)
+        b = uint8_t(rd());
+    uint8_t dk[Sha256::DIGEST];
+    pbkdf2Sha256(password, string_view((const char *)salt, sizeof salt), iterations, dk);
+    return "pbkdf2-sha256$" + to_string(iterations) + "$" + toHex(salt, sizeof salt) + "$" +
+           toHex(dk, sizeof dk);
+}
+
+// False for a wrong password or a malformed stored hash.
+inline bool verifyPassword(string_view password, string_view stored)
+{
+    const string_view scheme = "pbkdf2-sha256$";
+    if (stored.substr(0, scheme.size()) != scheme)
+        return false;
+    stored.remove_prefix(scheme.size());
+    size_t a = stored.find('$'), b = stored.find('$', a + 1);
+    int iterations;
+    string salt, expected;
+    if (b == string_view::npos || !parseInt(stored.substr(0, a), iterations) || iterations < 1 ||
+        !fromHex(stored.substr(a + 1, b - a - 1), salt) || !fromHex(stored.substr(b + 1), expected))
+        return false;
+    uint8_t dk[Sha256::DIGEST];
+    pbkdf2Sha256(password, salt, iterations, dk);
+    return constantTimeEquals(string_view((const char *)dk, sizeof dk), expected);
+}
+
+#endif
@@ -4,6 +4,16 @@
 #include <vector>
 #include <ctime>
 #include <iomanip>
+#include <cstdlib>
+#include <filesystem>
+#include <unordered_map>
+#include <map>
+#include <charconv>
+#include <algorithm>
+#include "csv_io.h"
+#include "password_hash.h"
+#include "binary_snapshot.h"
+#include "tariff.h"
 using namespace std;
 
 struct User {
@@ -11,7 +21,7 @@ struct User {
     string firstName;
     string lastName;
     string email;
-    string password;
+    string passwordHash; // see password_hash.h; never the password itself
     string role; // "admin" or "attendant"
 };
 
@@ -20,7 +30,8 @@ struct Parking {
     string name;
     int availableSpaces;
     string location;
-    float feePerHour;
+    Tariff tariff;
+    TariffTable prices; // compiled from tariff by applyParking()
 };
 
 struct CarEntry {
@@ -29,43 +40,497 @@ struct CarEntry {
     string parkingCode;
     time_t entryTime;
     time_t exitTime;
-    float chargedAmount;
+    Money chargedAmount; // minor units, see tariff.h
     bool exited;
 };
 
+// Users live contiguously in `users`; the maps hold their positions, so
+// registration and login never scan or copy the list.
 vector<User> users;
+unordered_map<int, size_t> userById;
+unordered_map<string, size_t> userByEmail;
 vector<Parking> parkings;
-vector<CarEntry> carEntries;
+unordered_map<string, size_t> parkingByCode;
+// Cars still parked are kept apart from the history so exit processing only
+// touches the small hot set: openEntries is unordered and indexed by entry
+// id and plate; closedEntries only grows.
+vector<CarEntry> openEntries;
+unordered_map<int, size_t> openById;
+unordered_map<string, size_t> openByPlate;
+vector<CarEntry> closedEntries;
 int currentUserId = -1;
 string currentUserRole = "";
 
+// ======== Revenue Rollups ========
+// Kept up to date by every exit (live, replayed or loaded), so reports read
+// only these buckets and never the entry history.
+const int DURATION_BUCKETS = 8;
+const int DURATION_EDGES_MIN[DURATION_BUCKETS - 1] = {15, 30, 60, 120, 240, 480, 1440};
+
+struct Rollup {
+    long long exits = 0;
+    Money revenue = 0;
+    long long seconds = 0; // total time parked
+};
+
+struct ParkingRollup : Rollup {
+    long long durations[DURATION_BUCKETS] = {}; // exits per stay length
+};
+
+unordered_map<string, ParkingRollup> rollupByParking; // by parking code
+map<long long, Rollup> rollupByHour;                   // by exit time / 3600
+
+int durationBucket(long long seconds) {
+    int b = 0;
+    while (b < DURATION_BUCKETS - 1 && seconds >= DURATION_EDGES_MIN[b] * 60LL)
+        ++b;
+    return b;
+}
+
+void recordExit(const CarEntry &e) {
+    long long stay = max<long long>(0, e.exitTime - e.entryTime);
+    ParkingRollup &p = rollupByParking[e.parkingCode];
+    Rollup &h = rollupByHour[e.exitTime / 3600];
+    for (Rollup *r : {(Rollup *)&p, &h}) {
+        r->exits++;
+        r->revenue += e.chargedAmount;
+        r->seconds += stay;
+    }
+    p.durations[durationBucket(stay)]++;
+}
+
 time_t getCurrentTime() {
     return time(0);
 }
 
+// localtime() re-reads the time zone on every call, which dominates
+// reports and exports that format millions of times.
+tm localParts(time_t t) {
+    tm parts;
+#ifdef _WIN32
+    localtime_s(&parts, &t);
+#else
+    localtime_r(&t, &parts);
+#endif
+    return parts;
+}
+
 string formatTime(time_t rawTime) {
     char buffer[80];
-    struct tm * timeinfo = localtime(&rawTime);
-    strftime(buffer, 80, "%Y-%m-%d %H:%M:%S", timeinfo);
+    tm timeinfo = localParts(rawTime);
+    strftime(buffer, 80, "%Y-%m-%d %H:%M:%S", &timeinfo);
     return string(buffer);
 }
 
+// ======== Storage ========
+// Everything is kept under $DATA_DIR/pms (data/pms by default):
+//   snapshot-<seq>/  users.csv, parkings.csv, car_entries.bin
+//   CURRENT          the <seq> of the snapshot in use
+//   journal.log      one "<seq>,<kind>,<fields>" record per change
+// Changes are applied in memory, then appended to the journal; nothing is
+// rewritten per change. Once the journal outgrows half the tables (at least
+// JOURNAL_COMPACT_MIN records) the tables are written to a new snapshot,
+// CURRENT is switched to it and the journal is truncated. Startup loads the
+// snapshot named by CURRENT and replays journal records with a larger seq,
+// so a crash at any point of a compaction neither loses nor repeats one.
+// Car entries, the only large table, use the binary columnar format of
+// binary_snapshot.h so a restart does not parse text.
+// Money is stored as integer minor units. Files and records from before
+// that (a fee_per_hour column, float charges, "X" exit records) are still
+// read and converted on load.
+const int JOURNAL_SYNC_BATCH = 32;
+const int JOURNAL_COMPACT_MIN = 10000;
+
+FILE *journal = nullptr;
+long long journalSeq = 0;  // seq of the last change
+long long snapshotSeq = 0; // last seq covered by the snapshot
+int journalRecords = 0, unsyncedRecords = 0;
+
+string dataDir() {
+    return string(getenv("DATA_DIR") ? getenv("DATA_DIR") : "data") + "/pms";
+}
+
+string dataPath(const string &file) {
+    return dataDir() + "/" + file;
+}
+
+string snapshotDir(long long seq) {
+    return dataPath("snapshot-" + to_string(seq));
+}
+
+bool parseFloat(string_view s, float &out) {
+    auto r = from_chars(s.data(), s.data() + s.size(), out);
+    return r.ec == errc() && r.ptr == s.data() + s.size();
+}
+
+bool parseTime(string_view s, time_t &out) {
+    long long v = 0;
+    auto r = from_chars(s.data(), s.data() + s.size(), v);
+    out = v;
+    return r.ec == errc() && r.ptr == s.data() + s.size();
+}
+
+// -- In-memory changes, shared by the menu actions and journal replay --
+void indexUser(size_t i) {
+    userById[users[i].id] = i;
+    userByEmail[users[i].email] = i;
+}
+
+bool applyUser(const User &u) {
+    if (userById.count(u.id) || userByEmail.count(u.email))
+        return false;
+    users.push_back(u);
+    indexUser(users.size() - 1);
+    return true;
+}
+
+// Parkings from before tariffs billed feePerHour pro rata: an hour at the
+// fee, charged by the minute.
+Tariff legacyTariff(float feePerHour) {
+    Tariff t;
+    t.blockMinutes = 60;
+    t.blockPrices = {moneyFromFloat(feePerHour)};
+    t.proRata = true;
+    return t;
+}
+
+bool applyParking(Parking p) {
+    if (parkingByCode.count(p.code))
+        return false;
+    p.prices = TariffTable(p.tariff);
+    parkingByCode[p.code] = parkings.size();
+    parkings.push_back(move(p));
+    return true;
+}
+
+Parking *findParking(const string &code) {
+    auto it = parkingByCode.find(code);
+    return it == parkingByCode.end() ? nullptr : &parkings[it->second];
+}
+
+CarEntry *findOpenEntry(int id) {
+    auto it = openById.find(id);
+    return it == openById.end() ? nullptr : &openEntries[it->second];
+}
+
+CarEntry *findOpenEntryByPlate(const string &plate) {
+    auto it = openByPlate.find(plate);
+    return it == openByPlate.end() ? nullptr : &openEntries[it->second];
+}
+
+void indexOpen(size_t i) {
+    openById[openEntries[i].id] = i;
+    openByPlate[openEntries[i].plateNumber] = i;
+}
+
+void applyEntry(const CarEntry &c) {
+    if (Parking *p = findParking(c.parkingCode))
+        p->availableSpaces--;
+    openEntries.push_back(c);
+    indexOpen(openEntries.size() - 1);
+}
+
+// Moves the entry to the history; the last open entry takes its slot.
+bool applyExit(int id, time_t exitTime, Money charged) {
+    auto it = openById.find(id);
+    if (it == openById.end())
+        return false;
+    size_t i = it->second;
+    CarEntry &e = openEntries[i];
+    e.exitTime = exitTime;
+    e.chargedAmount = charged;
+    e.exited = true;
+    recordExit(e);
+    if (Parking *p = findParking(e.parkingCode))
+        p->availableSpaces++;
+    openById.erase(it);
+    openByPlate.erase(e.plateNumber);
+    closedEntries.push_back(move(e));
+    if (i != openEntries.size() - 1) {
+        openEntries[i] = move(openEntries.back());
+        indexOpen(i);
+    }
+    openEntries.pop_back();
+    return true;
+}
+
+// -- Tariff fields --
+// Stored as grace_minutes,block_minutes,block_prices,daily_cap,pro_rata.
+string tariffFields(const Tariff &t) {
+    return to_string(t.graceMinutes) + "," + to_string(t.blockMinutes) + "," + blockPricesText(t.blockPrices) + "," +
+           to_string(t.dailyCap) + "," + (t.proRata ? "1" : "0");
+}
+
+// Also accepts the lone fee_per_hour field written before tariffs, and
+// rows from before pro_rata. A converted fee must still bill an hour at
+// exactly the fee.
+bool parseTariff(const vector<string_view> &c, size_t at, Tariff &t) {
+    float fee;
+    if (c.size() < at + 4) {
+        if (c.size() <= at || !parseFloat(c[at], fee))
+            return false;
+        t = legacyTariff(fee);
+        return TariffTable(t).price(3600) == moneyFromFloat(fee);
+    }
+    int proRata = 0;
+    if (c.size() > at + 4 && !parseInt(c[at + 4], proRata))
+        return false;
+    t.proRata = proRata;
+    return parseInt(c[at], t.graceMinutes) && parseInt(c[at + 1], t.blockMinutes) &&
+           parseBlockPrices(c[at + 2], t.blockPrices) && parseMinor(c[at + 3], t.dailyCap) && validTariff(t);
+}
+
+// -- Snapshots --
+const initializer_list<ColumnType> CAR_ENTRY_COLUMNS = {COL_INT32, COL_STRING, COL_STRING, COL_INT64,
+                                                       COL_INT64, COL_INT64, COL_INT32};
+// Before fixed-point money the charge column held float bits.
+const initializer_list<ColumnType> LEGACY_CAR_ENTRY_COLUMNS = {COL_INT32, COL_STRING, COL_STRING, COL_INT64,
+                                                              COL_INT64, COL_INT32, COL_INT32};
+
+bool saveSnapshot(const string &dir) {
+    CsvWriter u(dir + "/users.csv");
+    u.header("id,first_name,last_name,email,role,password_hash");
+    for (const User &x : users) {
+        u.field(x.id).field(x.firstName).field(x.lastName).field(x.email).field(x.role).field(x.passwordHash);
+        u.endRow();
+    }
+    CsvWriter p(dir + "/parkings.csv");
+    p.header("code,name,available_spaces,location,grace_minutes,block_minutes,block_prices,daily_cap,pro_rata");
+    for (const Parking &x : parkings) {
+        const Tariff &t = x.tariff;
+        p.field(x.code).field(x.name).field(x.availableSpaces).field(x.location).field(t.graceMinutes)
+         .field(t.blockMinutes).field(blockPricesText(t.blockPrices)).field(to_string(t.dailyCap))
+         .field(t.proRata ? 1 : 0);
+        p.endRow();
+    }
+    SnapshotWriter c(CAR_ENTRY_COLUMNS);
+    for (auto *list : {&closedEntries, &openEntries}) {
+        for (const CarEntry &x : *list) {
+            c.i32(x.id).str(x.plateNumber).str(x.parkingCode).i64(x.entryTime).i64(x.exitTime)
+             .i64(x.chargedAmount).i32(x.exited ? 1 : 0);
+            c.endRow();
+        }
+    }
+    bool ok = u.commit();
+    ok = p.commit() && ok;
+    return c.commit(dir + "/car_entries.bin") && ok;
+}
+
+void loadUsers(const string &fn) {
+    CsvReader r(fn);
+    if (!r.ok())
+        return;
+    r.skipHeader();
+    vector<string_view> c;
+    while (r.next(c)) {
+        User u;
+        if (c.size() < 6 || !parseInt(c[0], u.id))
+            continue;
+        u.firstName = toString(c[1]);
+        u.lastName = toString(c[2]);
+        u.email = toString(c[3]);
+        u.role = toString(c[4]);
+        u.passwordHash = toString(c[5]);
+        applyUser(u);
+    }
+}
+
+void loadSnapshot(const string &dir) {
+    loadUsers(dir + "/users.csv");
+    vector<string_view> c;
+    CsvReader p(dir + "/parkings.csv");
+    p.skipHeader();
+    while (p.next(c)) {
+        Parking x;
+        if (c.size() < 5 || !parseInt(c[2], x.availableSpaces) || !parseTariff(c, 4, x.tariff))
+            continue;
+        x.code = toString(c[0]);
+        x.name = toString(c[1]);
+        x.location = toString(c[3]);
+        applyParking(x);
+    }
+    SnapshotReader e(dir + "/car_entries.bin");
+    bool legacy = e.matches(LEGACY_CAR_ENTRY_COLUMNS);
+    if (!legacy && !e.matches(CAR_ENTRY_COLUMNS)) {
+        if (e.ok() || filesystem::exists(dir + "/car_entries.bin"))
+            cout << "Warning: " << dir << "/car_entries.bin is unreadable\n";
+        return;
+    }
+    // The spaces in parkings.csv already account for open entries, so they
+    // are indexed directly rather than through applyEntry().
+    closedEntries.reserve(e.rows());
+    for (uint64_t i = 0; i < e.rows(); ++i) {
+        CarEntry x{e.i32(0, i), toString(e.str(1, i)), toString(e.str(2, i)), (time_t)e.i64(3, i),
+                   (time_t)e.i64(4, i), 0, e.i32(6, i) != 0};
+        if (legacy) {
+            int32_t bits = e.i32(5, i);
+            float charged;
+            memcpy(&charged, &bits, sizeof charged);
+            x.chargedAmount = moneyFromFloat(charged);
+        } else {
+            x.chargedAmount = e.i64(5, i);
+        }
+        if (x.exited) {
+            recordExit(x);
+            closedEntries.push_back(move(x));
+        } else {
+            openEntries.push_back(move(x));
+            indexOpen(openEntries.size() - 1);
+        }
+    }
+}
+
+// -- Journal --
+void closeJournal() {
+    if (!journal)
+        return;
+    syncFile(journal);
+    fclose(journal);
+    journal = nullptr;
+    unsyncedRecords = 0;
+}
+
+// Writes the tables to snapshot-<journalSeq>, switches CURRENT to it, then
+// drops the journal and older snapshots. Nothing is dropped on failure.
+bool compact() {
+    string dir = snapshotDir(journalSeq);
+    error_code ec;
+    filesystem::create_directories(dir, ec);
+    string current = to_string(journalSeq) + "\n";
+    if (!saveSnapshot(dir) || !writeFileAtomic(dataPath("CURRENT"), current.data(), current.size())) {
+        cout << "Warning: could not write a snapshot; keeping the journal.\n";
+        return false;
+    }
+    snapshotSeq = journalSeq;
+    closeJournal();
+    if (FILE *f = fopen(dataPath("journal.log").c_str(), "wb"))
+        fclose(f);
+    journalRecords = 0;
+    for (auto &d : filesystem::directory_iterator(dataDir(), ec)) {
+        string name = d.path().filename().string();
+        if (name.rfind("snapshot-", 0) == 0 && d.path().string() != dir)
+            filesystem::remove_all(d.path(), ec);
+    }
+    return true;
+}
+
+// Appends one change that has already been applied in memory.
+void appendJournal(const string &record) {
+    if (!journal)
+        journal = fopen(dataPath("journal.log").c_str(), "ab");
+    ++journalSeq;
+    if (!journal) {
+        compact(); // journal unavailable: fall back to a full snapshot
+        return;
+    }
+    string line = to_string(journalSeq) + "," + record + "\n";
+    fputs(line.c_str(), journal);
+    fflush(journal);
+    ++journalRecords;
+    if (++unsyncedRecords >= JOURNAL_SYNC_BATCH) {
+        syncFile(journal);
+        unsyncedRecords = 0;
+    }
+    size_t rows = users.size() + parkings.size() + openEntries.size() + closedEntries.size();
+    if ((size_t)journalRecords >= max<size_t>(JOURNAL_COMPACT_MIN, rows / 2))
+        compact();
+}
+
+// Records at or below snapshotSeq are already in the snapshot. A torn
+// trailing record from a crash fails to parse and is ignored.
+void replayJournal() {
+    CsvReader r(dataPath("journal.log"));
+    vector<string_view> c;
+    while (r.next(c)) {
+        long long seq;
+        if (c.size() < 3 || from_chars(c[0].data(), c[0].data() + c[0].size(), seq).ec != errc())
+            continue;
+        ++journalRecords;
+        journalSeq = max(journalSeq, seq);
+        if (seq <= snapshotSeq)
+            continue;
+        string_view kind = c[1];
+        if (kind == "U" && c.size() >= 8) {
+            User u;
+            if (!parseInt(c[2], u.id))
+                continue;
+            u.firstName = toString(c[3]);
+            u.lastName = toString(c[4]);
+            u.email = toString(c[5]);
+            u.role = toString(c[6]);
+            u.passwordHash = toString(c[7]);
+            applyUser(u);
+        } else if (kind == "P" && c.size() >= 7) {
+            Parking p;
+            if (!parseInt(c[4], p.availableSpaces) || !parseTariff(c, 6, p.tariff))
+                continue;
+            p.code = toString(c[2]);
+            p.name = toString(c[3]);
+            p.location = toString(c[5]);
+            applyParking(p);
+        } else if (kind == "E" && c.size() >= 6) {
+            CarEntry e{0, toString(c[3]), toString(c[4]), 0, 0, 0, false};
+            if (parseInt(c[2], e.id) && parseTime(c[5], e.entryTime))
+                applyEntry(e);
+        } else if (kind == "C" && c.size() >= 5) {
+            int id;
+            time_t t;
+            Money charged;
+            if (parseInt(c[2], id) && parseTime(c[3], t) && parseMinor(c[4], charged))
+                applyExit(id, t, charged);
+        } else if (kind == "X" && c.size() >= 5) { // exit charged as a float
+            int id;
+            time_t t;
+            float charged;
+            if (parseInt(c[2], id) && parseTime(c[3], t) && parseFloat(c[4], charged))
+                applyExit(id, t, moneyFromFloat(charged));
+        }
+    }
+}
+
+// Read once at startup. Before the journal existed, users were kept in
+// a bare users.csv; it is folded into the first snapshot.
+void loadStore() {
+    error_code ec;
+    filesystem::create_directories(dataDir(), ec);
+    CsvReader cur(dataPath("CURRENT"));
+    vector<string_view> c;
+    if (cur.ok() && cur.next(c) && !c.empty() &&
+        from_chars(c[0].data(), c[0].data() + c[0].size(), snapshotSeq).ec == errc()) {
+        loadSnapshot(snapshotDir(snapshotSeq));
+        journalSeq = snapshotSeq;
+    }
+    replayJournal();
+    string legacy = dataPath("users.csv");
+    if (filesystem::exists(legacy)) {
+        loadUsers(legacy);
+        if (compact())
+            remove(legacy.c_str());
+    }
+}
+
 void registerUser() {
     User u;
+    string password;
     cout << "Enter ID: "; cin >> u.id;
     cout << "Enter First Name: "; cin >> u.firstName;
     cout << "Enter Last Name: "; cin >> u.lastName;
     cout << "Enter Email: "; cin >> u.email;
-    cout << "Enter Password: "; cin >> u.password;
+    cout << "Enter Password: "; cin >> password;
     cout << "Enter Role (admin/attendant): "; cin >> u.role;
 
-    for (User user : users) {
-        if (user.id == u.id) {
-            cout << "User ID already exists.\n";
-            return;
-        }
+    if (userById.count(u.id)) {
+        cout << "User ID already exists.\n";
+        return;
     }
-    users.push_back(u);
+    if (userByEmail.count(u.email)) {
+        cout << "Email already registered.\n";
+        return;
+    }
+    u.passwordHash = hashPassword(password);
+    applyUser(u);
+    appendJournal("U," + to_string(u.id) + "," + csvEscape(u.firstName) + "," + csvEscape(u.lastName) + "," +
+                  csvEscape(u.email) + "," + csvEscape(u.role) + "," + u.passwordHash);
     cout << "User registered successfully.\n";
 }
 
@@ -73,13 +538,17 @@ bool login() {
     string email, password;
     cout << "Email: "; cin >> email;
     cout << "Password: "; cin >> password;
-    for (User u : users) {
-        if (u.email == email && u.password == password) {
-            currentUserId = u.id;
-            currentUserRole = u.role;
-            cout << "Login successful as " << currentUserRole << "\n";
-            return true;
-        }
+    auto it = userByEmail.find(email);
+    // An unknown email is checked against a throwaway hash, so the reply
+    // takes as long as for a wrong password and does not reveal which
+    // emails are registered.
+    static const string decoy = hashPassword("");
+    const User *u = it == userByEmail.end() ? nullptr : &users[it->second];
+    if (verifyPassword(password, u ? u->passwordHash : decoy) && u) {
+        currentUserId = u->id;
+        currentUserRole = u->role;
+        cout << "Login successful as " << currentUserRole << "\n";
+        return true;
     }
     cout << "Invalid credentials.\n";
     return false;
@@ -91,19 +560,33 @@ void addParking() {
         return;
     }
     Parking p;
+    Tariff &t = p.tariff;
+    string prices, cap;
     cout << "Enter Parking Code: "; cin >> p.code;
     cout << "Enter Name: "; cin >> p.name;
     cout << "Available Spaces: "; cin >> p.availableSpaces;
     cout << "Location: "; cin >> p.location;
-    cout << "Fee per Hour: "; cin >> p.feePerHour;
-    parkings.push_back(p);
+    cout << "Free Minutes: "; cin >> t.graceMinutes;
+    cout << "Block Length (minutes): "; cin >> t.blockMinutes;
+    cout << "Price per Block (e.g. 500, or 500,300 for a cheaper second block on): "; cin >> prices;
+    cout << "Daily Cap (0 for none): "; cin >> cap;
+    if (!parseBlockPrices(prices, t.blockPrices, parseMoney) || !parseMoney(cap, t.dailyCap) || !validTariff(t)) {
+        cout << "Invalid tariff.\n";
+        return;
+    }
+    if (!applyParking(p)) {
+        cout << "Parking code already exists.\n";
+        return;
+    }
+    appendJournal("P," + csvEscape(p.code) + "," + csvEscape(p.name) + "," + to_string(p.availableSpaces) + "," +
+                  csvEscape(p.location) + "," + tariffFields(t));
     cout << "Parking added successfully.\n";
 }
 
 void viewParkings() {
-    for (Parking p : parkings) {
+    for (const Parking &p : parkings) {
         cout << "Code: " << p.code << ", Name: " << p.name << ", Spaces: " << p.availableSpaces
-             << ", Fee/hr: " << p.feePerHour << ", Location: " << p.location << "\n";
+             << ", Tariff: " << describeTariff(p.tariff) << ", Location: " << p.location << "\n";
     }
 }
 
@@ -113,63 +596,259 @@ void carEntry() {
     cout << "Plate Number: "; cin >> c.plateNumber;
     cout << "Parking Code: "; cin >> c.parkingCode;
 
-    bool found = false;
-    for (auto &p : parkings) {
-        if (p.code == c.parkingCode) {
-            if (p.availableSpaces <= 0) {
-                cout << "No space available.\n";
-                return;
-            }
-            p.availableSpaces--;
-            found = true;
-            break;
-        }
-    }
-    if (!found) {
+    Parking *p = findParking(c.parkingCode);
+    if (!p) {
         cout << "Invalid parking code.\n";
         return;
     }
+    if (p->availableSpaces <= 0) {
+        cout << "No space available.\n";
+        return;
+    }
+    if (findOpenEntry(c.id)) {
+        cout << "Entry ID is already in use by a parked car.\n";
+        return;
+    }
+    if (findOpenEntryByPlate(c.plateNumber)) {
+        cout << "This car is already parked.\n";
+        return;
+    }
     c.entryTime = getCurrentTime();
     c.exitTime = 0;
-    c.chargedAmount = 0.0f;
+    c.chargedAmount = 0;
     c.exited = false;
-    carEntries.push_back(c);
+    applyEntry(c);
+    appendJournal("E," + to_string(c.id) + "," + csvEscape(c.plateNumber) + "," + csvEscape(c.parkingCode) + "," +
+                  to_string((long long)c.entryTime));
     cout << "Car entry registered.\n";
 }
 
 void carExit() {
+    string key;
+    cout << "Enter Entry ID or Plate Number: "; cin >> key;
     int entryId;
-    cout << "Enter Entry ID: "; cin >> entryId;
-    for (auto &entry : carEntries) {
-        if (entry.id == entryId && !entry.exited) {
-            entry.exitTime = getCurrentTime();
-            double hours = difftime(entry.exitTime, entry.entryTime) / 3600.0;
-            for (auto &p : parkings) {
-                if (p.code == entry.parkingCode) {
-                    entry.chargedAmount = p.feePerHour * hours;
-                    p.availableSpaces++;
-                    break;
-                }
-            }
-            entry.exited = true;
-            cout << "Car exited. Duration: " << fixed << setprecision(2) << hours << " hours, Charged: " << entry.chargedAmount << " RWF\n";
-            return;
+    CarEntry *entry = parseInt(key, entryId) ? findOpenEntry(entryId) : nullptr;
+    if (!entry)
+        entry = findOpenEntryByPlate(key);
+    if (!entry) {
+        cout << "Car entry not found or already exited.\n";
+        return;
+    }
+    entryId = entry->id;
+    time_t exitTime = getCurrentTime();
+    long long stay = exitTime - entry->entryTime;
+    Parking *p = findParking(entry->parkingCode);
+    Money charged = p ? p->prices.price(stay) : 0;
+    applyExit(entryId, exitTime, charged);
+    appendJournal("C," + to_string(entryId) + "," + to_string((long long)exitTime) + "," + to_string(charged));
+    cout << "Car exited. Duration: " << fixed << setprecision(2) << stay / 3600.0 << " hours, Charged: "
+         << formatMoney(charged) << " RWF\n";
+}
+
+// ======== Reports ========
+void printRollup(const string &label, const Rollup &r) {
+    cout << label << ": " << r.exits << " exits, revenue " << formatMoney(r.revenue) << " RWF";
+    if (r.exits)
+        cout << ", average stay " << r.seconds / r.exits / 60 << " min";
+    cout << "\n";
+}
+
+// O(parkings).
+void revenueByParking() {
+    Rollup total;
+    for (const Parking &p : parkings) {
+        auto it = rollupByParking.find(p.code);
+        if (it == rollupByParking.end())
+            continue;
+        printRollup(p.code + " (" + p.name + ")", it->second);
+        total.exits += it->second.exits;
+        total.revenue += it->second.revenue;
+        total.seconds += it->second.seconds;
+    }
+    printRollup("All parkings", total);
+}
+
+// Folds the hourly buckets into local calendar days; O(hour buckets).
+void revenueByDay() {
+    map<string, Rollup> days;
+    for (auto &kv : rollupByHour) {
+        tm parts = localParts(kv.first * 3600);
+        char day[11];
+        strftime(day, sizeof day, "%Y-%m-%d", &parts);
+        Rollup &d = days[day];
+        d.exits += kv.second.exits;
+        d.revenue += kv.second.revenue;
+        d.seconds += kv.second.seconds;
+    }
+    for (auto &kv : days)
+        printRollup(kv.first, kv.second);
+}
+
+// Local hour-of-day profile over all days; O(hour buckets).
+void revenueByHourOfDay() {
+    Rollup hours[24];
+    for (auto &kv : rollupByHour) {
+        Rollup &h = hours[localParts(kv.first * 3600).tm_hour];
+        h.exits += kv.second.exits;
+        h.revenue += kv.second.revenue;
+        h.seconds += kv.second.seconds;
+    }
+    for (int h = 0; h < 24; ++h) {
+        char label[16];
+        snprintf(label, sizeof label, "%02d:00-%02d:59", h, h);
+        printRollup(label, hours[h]);
+    }
+}
+
+// Exits per stay length, per parking and overall; O(parkings x buckets).
+void stayDurations() {
+    long long all[DURATION_BUCKETS] = {};
+    auto print = [](const string &label, const long long *d) {
+        cout << label << ":";
+        for (int b = 0; b < DURATION_BUCKETS; ++b) {
+            if (b < DURATION_BUCKETS - 1)
+                cout << " <" << DURATION_EDGES_MIN[b] << "m=" << d[b];
+            else
+                cout << " >=" << DURATION_EDGES_MIN[b - 1] << "m=" << d[b];
+        }
+        cout << "\n";
+    };
+    for (auto &kv : rollupByParking) {
+        print(kv.first, kv.second.durations);
+        for (int b = 0; b < DURATION_BUCKETS; ++b)
+            all[b] += kv.second.durations[b];
+    }
+    print("All parkings", all);
+}
+
+// Streams every exit to `out` one row at a time through a fixed stdio
+// buffer, so the export never holds more than a row in memory. The file is
+// written beside the target and renamed into place when complete.
+bool exportExits(const string &out) {
+    string tmp = out + ".tmp";
+    FILE *f = fopen(tmp.c_str(), "wb");
+    if (!f)
+        return false;
+    vector<char> buf(1 << 16);
+    setvbuf(f, buf.data(), _IOFBF, buf.size());
+    auto text = [f](const string &s) {
+        if (s.find_first_of(",\"\r\n") == string::npos)
+            fputs(s.c_str(), f);
+        else
+            fputs(csvEscape(s).c_str(), f);
+    };
+    fputs("id,plate_number,parking_code,entry_time,exit_time,duration_seconds,charged_amount\n", f);
+    for (const CarEntry &e : closedEntries) {
+        fprintf(f, "%d,", e.id);
+        text(e.plateNumber);
+        fputc(',', f);
+        text(e.parkingCode);
+        fprintf(f, ",%s,%s,%lld,%s\n", formatTime(e.entryTime).c_str(), formatTime(e.exitTime).c_str(),
+                (long long)(e.exitTime - e.entryTime), formatMoney(e.chargedAmount).c_str());
+    }
+    bool ok = !ferror(f);
+    syncFile(f);
+    ok = fclose(f) == 0 && ok;
+    error_code ec;
+    if (ok)
+        filesystem::rename(tmp, out, ec);
+    if (!ok || ec) {
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Re-prices every exit of one local calendar month with today's tariffs and
+// reports where that differs from what was charged. Stays and charges are
+// gathered per parking into plain arrays and priced in one batch each.
+void auditMonth() {
+    string month;
+    cout << "Month (YYYY-MM): "; cin >> month;
+    tm from = {};
+    if (sscanf(month.c_str(), "%d-%d", &from.tm_year, &from.tm_mon) != 2 || from.tm_mon < 1 || from.tm_mon > 12) {
+        cout << "Invalid month.\n";
+        return;
+    }
+    from.tm_year -= 1900;
+    from.tm_mon -= 1;
+    from.tm_mday = 1;
+    from.tm_isdst = -1;
+    tm to = from;
+    to.tm_mon += 1;
+    time_t begin = mktime(&from), end = mktime(&to);
+
+    struct Batch {
+        vector<int64_t> stays;
+        vector<Money> charged;
+    };
+    map<string, Batch> batches;
+    for (const CarEntry &e : closedEntries) {
+        if (e.exitTime < begin || e.exitTime >= end)
+            continue;
+        Batch &b = batches[e.parkingCode];
+        b.stays.push_back(e.exitTime - e.entryTime);
+        b.charged.push_back(e.chargedAmount);
+    }
+    Money billedAll = 0, repricedAll = 0;
+    long long exitsAll = 0, differAll = 0;
+    vector<Money> prices;
+    for (auto &kv : batches) {
+        const Batch &b = kv.second;
+        prices.assign(b.stays.size(), 0);
+        if (Parking *p = findParking(kv.first))
+            p->prices.priceBatch(b.stays.data(), prices.data(), prices.size());
+        Money billed = 0, repriced = 0;
+        long long differ = 0;
+        for (size_t i = 0; i < prices.size(); ++i) {
+            billed += b.charged[i];
+            repriced += prices[i];
+            differ += b.charged[i] != prices[i];
         }
+        cout << kv.first << ": " << prices.size() << " exits, charged " << formatMoney(billed) << " RWF, current tariff "
+             << formatMoney(repriced) << " RWF, " << differ << " differ\n";
+        billedAll += billed;
+        repricedAll += repriced;
+        exitsAll += prices.size();
+        differAll += differ;
     }
-    cout << "Car entry not found or already exited.\n";
+    cout << "All parkings: " << exitsAll << " exits, charged " << formatMoney(billedAll) << " RWF, current tariff "
+         << formatMoney(repricedAll) << " RWF, " << differAll << " differ\n";
 }
 
 void viewReports() {
-    cout << "Car Exits Report:\n";
-    for (CarEntry e : carEntries) {
-        if (e.exited) {
-            cout << "Plate: " << e.plateNumber << ", From: " << formatTime(e.entryTime) << ", To: " << formatTime(e.exitTime)
-                 << ", Amount: " << e.chargedAmount << "\n";
+    cout << "1. Car Exits\n2. Revenue by Parking\n3. Revenue by Day\n4. Revenue by Hour of Day\n"
+         << "5. Stay Durations\n6. Export Exits to CSV\n7. Audit Charges for a Month\nChoice: ";
+    int choice;
+    cin >> choice;
+    switch (choice) {
+        case 1:
+            cout << "Car Exits Report:\n";
+            for (const CarEntry &e : closedEntries) {
+                cout << "Plate: " << e.plateNumber << ", From: " << formatTime(e.entryTime) << ", To: " << formatTime(e.exitTime)
+                     << ", Amount: " << formatMoney(e.chargedAmount) << "\n";
+            }
+            break;
+        case 2: revenueByParking(); break;
+        case 3: revenueByDay(); break;
+        case 4: revenueByHourOfDay(); break;
+        case 5: stayDurations(); break;
+        case 6: {
+            string path;
+            cout << "Output file: "; cin >> path;
+            if (exportExits(path))
+                cout << "Exported " << closedEntries.size() << " exits to " << path << "\n";
+            else
+                cout << "Could not write " << path << "\n";
+            break;
         }
+        case 7: auditMonth(); break;
+        default: cout << "Invalid choice.\n";
     }
 }
 
 int main() {
+    loadStore();
     int choice;
     while (true) {
         cout << "\n--- Parking Management System ---\n";
@@ -183,7 +862,7 @@ int main() {
             case 5: carEntry(); break;
             case 6: carExit(); break;
             case 7: viewReports(); break;
-            case 8: return 0;
+            case 8: closeJournal(); return 0;
             default: cout << "Invalid choice.\n";
         }
     }
@@ -1,14 +1,30 @@
 #include <iostream>
 #include <string>
 #include <unordered_map>
-#include <unordered_set>
 #include <vector>
 #include <fstream>
 #include <sstream>
 #include <limits>
 #include <algorithm>
 #include <climits>
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <ctime>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <tuple>
+#include <array>
+#include <unordered_set>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <deque>
+#include "csv_io.h"
+#include "binary_snapshot.h"
+#include "node_index.h"
+#include "data_store.h"
 
 using namespace std;
 
@@ -57,109 +73,435 @@ struct ParkingSpot
     int id;
     string type;
     bool isOccupied;
+    // Optional placement, used to rank free spots.
+    string zone;
+    int level = 0;         // 0 = ground, negative = below ground
+    int exitDistance = -1; // meters to the exit, -1 if not known
     ParkingSpot *next;
 };
 
+// Free spots of one type as an indexed binary min-heap, best spot on top:
+// nearest the exit, then the level closest to ground, then the lowest id.
+// Spots with no known distance rank after all measured ones. pos maps a
+// spot id to its heap slot so an occupied spot leaves in O(log n).
+struct SpotPool
+{
+    struct Slot
+    {
+        int distance, level, id;
+        bool operator<(const Slot &o) const
+        {
+            return tie(distance, level, id) < tie(o.distance, o.level, o.id);
+        }
+    };
+    vector<Slot> heap;
+    unordered_map<int, size_t> pos;
+    int total = 0, occupied = 0;
+
+    size_t freeCount() const { return heap.size(); }
+    int best() const { return heap.empty() ? -1 : heap[0].id; }
+
+    void pushFree(const ParkingSpot &s)
+    {
+        if (pos.count(s.id))
+            return;
+        heap.push_back({s.exitDistance < 0 ? INT_MAX : s.exitDistance, abs(s.level), s.id});
+        pos[s.id] = heap.size() - 1;
+        siftUp(heap.size() - 1);
+    }
+    void removeFree(int id)
+    {
+        auto it = pos.find(id);
+        if (it == pos.end())
+            return;
+        size_t i = it->second;
+        pos.erase(it);
+        Slot last = heap.back();
+        heap.pop_back();
+        if (i == heap.size())
+            return;
+        place(i, last);
+        siftUp(i);
+        siftDown(pos[last.id]);
+    }
+
+private:
+    void place(size_t i, const Slot &v)
+    {
+        heap[i] = v;
+        pos[v.id] = i;
+    }
+    void siftUp(size_t i)
+    {
+        Slot v = heap[i];
+        while (i > 0 && v < heap[(i - 1) / 2])
+        {
+            place(i, heap[(i - 1) / 2]);
+            i = (i - 1) / 2;
+        }
+        place(i, v);
+    }
+    void siftDown(size_t i)
+    {
+        Slot v = heap[i];
+        size_t n = heap.size();
+        while (2 * i + 1 < n)
+        {
+            size_t c = 2 * i + 1;
+            if (c + 1 < n && heap[c + 1] < heap[c])
+                ++c;
+            if (!(heap[c] < v))
+                break;
+            place(i, heap[c]);
+            i = c;
+        }
+        place(i, v);
+    }
+};
+
+// Spot counts of one type, as reported by occupancy snapshots.
+struct TypeOccupancy
+{
+    string type;
+    int total = 0, occupied = 0;
+};
+
 struct ParkingSession
 {
     int id;
     string vehicleId; // License plate
     int spotId;
-    string entryTime, exitTime;
+    int64_t entryTime, exitTime; // epoch seconds; exitTime 0 while ongoing
     ParkingSession *next;
+    ParkingSession *prev = nullptr; // only maintained on the active list
+};
+
+// ======== Time Helpers ========
+// Session times are stored as epoch seconds; 0 means "not yet" (an open
+// session's exit). Text only appears at display time.
+
+// Accepts epoch digits or a legacy ctime()-style stamp; 0 if empty or
+// unparseable.
+int64_t parseStamp(string_view s)
+{
+    if (s.empty())
+        return 0;
+    int64_t v;
+    auto r = from_chars(s.data(), s.data() + s.size(), v);
+    if (r.ec == errc() && r.ptr == s.data() + s.size())
+        return v;
+    tm t{};
+    t.tm_isdst = -1;
+    istringstream in{string(s)};
+    in >> get_time(&t, "%a %b %d %H:%M:%S %Y");
+    return in.fail() ? 0 : (int64_t)mktime(&t);
+}
+
+string formatTime(int64_t t)
+{
+    if (t == 0)
+        return "";
+    time_t tt = t;
+    string out = ctime(&tt);
+    out.pop_back(); // '\n'
+    return out;
+}
+
+// "YYYY-MM-DD" in local time.
+string dayKey(int64_t t)
+{
+    time_t tt = t;
+    tm parts;
+#ifdef _WIN32
+    localtime_s(&parts, &tt);
+#else
+    localtime_r(&tt, &parts); // lots load on several threads
+#endif
+    char buf[11];
+    strftime(buf, sizeof buf, "%Y-%m-%d", &parts);
+    return buf;
+}
+
+// ======== Background Writer ========
+// Lots queue themselves here after a change and a single worker thread
+// saves them in arrival order. A lot that is already waiting is not queued
+// again, so a burst of changes to one lot costs one save.
+class ParkingLot;
+
+class PersistQueue
+{
+public:
+    explicit PersistQueue(function<void(ParkingLot *)> fn) : save(move(fn)), worker([this]() { run(); }) {}
+    ~PersistQueue() { stop(); }
+
+    // False once stopped; the caller then has to save the lot itself.
+    bool enqueue(ParkingLot *lot)
+    {
+        lock_guard<mutex> lk(m);
+        if (stopping)
+            return false;
+        if (queued.insert(lot).second)
+        {
+            pending.push_back(lot);
+            cv.notify_one();
+        }
+        return true;
+    }
+
+    // Drops a queued save of `lot` and waits for one in progress to end.
+    // Call before deleting the lot.
+    void forget(ParkingLot *lot)
+    {
+        unique_lock<mutex> lk(m);
+        if (queued.erase(lot))
+            pending.erase(find(pending.begin(), pending.end(), lot));
+        idle.wait(lk, [&]() { return current != lot; });
+    }
+
+    // Waits until every queued save is written.
+    void drain()
+    {
+        unique_lock<mutex> lk(m);
+        idle.wait(lk, [&]() { return pending.empty() && !current; });
+    }
+
+    // Writes what is queued, then ends the worker.
+    void stop()
+    {
+        {
+            lock_guard<mutex> lk(m);
+            stopping = true;
+        }
+        cv.notify_all();
+        if (worker.joinable())
+            worker.join();
+    }
+
+private:
+    mutex m;
+    condition_variable cv, idle;
+    deque<ParkingLot *> pending;
+    unordered_set<ParkingLot *> queued;
+    ParkingLot *current = nullptr;
+    bool stopping = false;
+    function<void(ParkingLot *)> save;
+    thread worker; // last: starts once the rest is constructed
+
+    void run()
+    {
+        unique_lock<mutex> lk(m);
+        while (true)
+        {
+            cv.wait(lk, [&]() { return stopping || !pending.empty(); });
+            if (pending.empty())
+                return;
+            current = pending.front();
+            pending.pop_front();
+            queued.erase(current);
+            lk.unlock();
+            save(current);
+            lk.lock();
+            current = nullptr;
+            idle.notify_all();
+        }
+    }
 };
 
 // ======== ParkingLot Class ========
+// Every public member function locks the lot, so gate terminals on
+// different threads can share it; lots never lock each other.
 class ParkingLot
 {
 public:
     string lotId, name, location;
+    string storePrefix; // path prefix of this lot's files ("<shard dir>/L3")
+    PersistQueue *writer = nullptr; // saves changes in the background if set
     Vehicle *vehicles = nullptr;
     ParkingSpot *spots = nullptr;
-    ParkingSession *sessions = nullptr;
+    ParkingSession *activeSessions = nullptr; // exitTime == 0
+    ParkingSession *sessions = nullptr;       // closed history
 
     int nextSpotId = 1;
     int nextSessionId = 1;
 
     ParkingLot() = default;
-    ParkingLot(const string &id, const string &nm, const string &loc)
-        : lotId(id), name(nm), location(loc)
+    ParkingLot(const string &id, const string &nm, const string &loc, const string &prefix)
+        : lotId(id), name(nm), location(loc), storePrefix(prefix)
     {
         loadData();
         normalizeCounters();
+        splitActiveSessions();
         updateSpotStatuses();
+        buildSpotPools();
+        rollArchive();
     }
 
     bool registerVehicle(const string &lp, const string &t, const string &own)
     {
+        lock_guard<recursive_mutex> lk(mtx);
         if (findVehicle(lp))
         {
             cout << "Vehicle already exists!\n";
             return false;
         }
         vehicles = new Vehicle{lp, t, own, vehicles};
-        saveData();
+        vehicleIndex[lp] = vehicles;
+        persist();
         return true;
     }
 
-    int addParkingSpot(const string &t)
+    int addParkingSpot(const string &t, const string &zone = "", int level = 0, int exitDistance = -1)
     {
+        lock_guard<recursive_mutex> lk(mtx);
         int id = nextSpotId++;
-        spots = new ParkingSpot{id, t, false, spots};
-        saveData();
+        spots = new ParkingSpot{id, t, false, zone, level, exitDistance, spots};
+        indexSpot(spots);
+        persist();
         return id;
     }
 
-    int startParkingSession(const string &vId, int sid, const string &entry)
+    // Spot types from smallest to largest. A vehicle fits spots of its own
+    // type and of every larger class; a type not listed here only fits
+    // spots of exactly that type. ParkingNetwork replaces the default from
+    // size_classes.csv in the parking data directory.
+    static inline vector<string> sizeClasses = {"motorcycle", "compact", "car", "suv", "van", "truck"};
+
+    // Types are free text as entered ("Car", "SUV"), so spots, vehicles and
+    // the ladder are matched on this lowercased key. Records keep the text.
+    static string typeKey(string type)
+    {
+        for (char &c : type)
+            c = tolower((unsigned char)c);
+        return type;
+    }
+
+    int freeSpots(const string &type) const
     {
-        if (!findVehicle(vId) || !findSpot(sid))
-            return -1;
+        lock_guard<recursive_mutex> lk(mtx);
+        auto it = pools.find(typeKey(type));
+        return it == pools.end() ? 0 : it->second.freeCount();
+    }
+    int occupiedSpots(const string &type) const
+    {
+        lock_guard<recursive_mutex> lk(mtx);
+        auto it = pools.find(typeKey(type));
+        return it == pools.end() ? 0 : it->second.occupied;
+    }
+
+    int startParkingSession(const string &vId, int sid, int64_t entry)
+    {
+        lock_guard<recursive_mutex> lk(mtx);
         ParkingSpot *spot = findSpot(sid);
+        if (!findVehicle(vId) || !spot)
+            return -1;
         if (spot->isOccupied)
             return -2;
+        if (activeByPlate.count(vId))
+            return -4;
 
         int id = nextSessionId++;
-        sessions = new ParkingSession{id, vId, sid, entry, "", sessions};
-        spot->isOccupied = true;
-        saveData();
+        auto *s = new ParkingSession{id, vId, sid, entry, 0, nullptr};
+        linkActive(s);
+        byEntry.emplace(entry, s);
+        occupy(spot);
+        persist();
         return id;
     }
 
-    bool endParkingSession(int sessionId, const string &exit)
+    // Parks the vehicle in any free spot of `type`; -3 if none is free.
+    int startParkingSessionAnySpot(const string &vId, const string &type, int64_t entry)
+    {
+        lock_guard<recursive_mutex> lk(mtx);
+        int sid = allocateSpot(type);
+        if (sid < 0)
+            return -3;
+        return startParkingSession(vId, sid, entry);
+    }
+
+    // Parks the vehicle in assignBestSpot() for its registered type; -1 if
+    // the vehicle is unknown, -3 if no compatible spot is free.
+    int startParkingSessionBestSpot(const string &vId, int64_t entry)
+    {
+        lock_guard<recursive_mutex> lk(mtx);
+        Vehicle *v = findVehicle(vId);
+        if (!v)
+            return -1;
+        int sid = assignBestSpot(v->type);
+        if (sid < 0)
+            return -3;
+        return startParkingSession(vId, sid, entry);
+    }
+
+    bool endParkingSession(int sessionId, int64_t exit)
     {
-        ParkingSession *session = findSession(sessionId);
-        if (!session || session->exitTime != "")
+        lock_guard<recursive_mutex> lk(mtx);
+        ParkingSession *session = unlinkActive(sessionId);
+        if (!session)
             return false;
 
         session->exitTime = exit;
+        session->next = sessions;
+        sessions = session;
         ParkingSpot *spot = findSpot(session->spotId);
         if (spot)
-            spot->isOccupied = false;
-        saveData();
+            release(spot);
+        if (!rollArchive())
+            persist();
         return true;
     }
 
+    // Ends the plate's open session; returns its id, or -1 if none is open.
+    int endParkingSessionForPlate(const string &vId, int64_t exit)
+    {
+        lock_guard<recursive_mutex> lk(mtx);
+        ParkingSession *s = activeSessionForPlate(vId);
+        if (!s)
+            return -1;
+        int id = s->id;
+        endParkingSession(id, exit);
+        return id;
+    }
+
+    // ======== Batched Updates ========
+    // Between beginBatch() and endBatch() mutations only mark the lot dirty;
+    // endBatch() writes it once.
+    void beginBatch()
+    {
+        lock_guard<recursive_mutex> lk(mtx);
+        batching = true;
+    }
+
+    bool endBatch()
+    {
+        {
+            lock_guard<recursive_mutex> lk(mtx);
+            batching = false;
+            if (!dirty)
+                return true;
+            dirty = false;
+        }
+        return saveData();
+    }
+
     // Delete functions
     bool deleteVehicle(const string &vId)
     {
+        lock_guard<recursive_mutex> lk(mtx);
         Vehicle **ptr = &vehicles;
         while (*ptr)
         {
             if ((*ptr)->id == vId)
             {
-                // Check for active sessions
-                for (auto *s = sessions; s; s = s->next)
+                if (activeByPlate.count(vId))
                 {
-                    if (s->vehicleId == vId && s->exitTime == "")
-                    {
-                        cout << "Cannot delete vehicle with active session\n";
-                        return false;
-                    }
+                    cout << "Cannot delete vehicle with active session\n";
+                    return false;
                 }
                 Vehicle *temp = *ptr;
                 *ptr = temp->next;
+                vehicleIndex.erase(vId);
                 delete temp;
-                saveData();
+                persist();
                 return true;
             }
             ptr = &(*ptr)->next;
@@ -169,6 +511,7 @@ public:
 
     bool deleteSpot(int sid)
     {
+        lock_guard<recursive_mutex> lk(mtx);
         ParkingSpot **ptr = &spots;
         while (*ptr)
         {
@@ -181,8 +524,9 @@ public:
                 }
                 ParkingSpot *temp = *ptr;
                 *ptr = temp->next;
+                unindexSpot(temp);
                 delete temp;
-                saveData();
+                persist();
                 return true;
             }
             ptr = &(*ptr)->next;
@@ -192,28 +536,38 @@ public:
 
     bool deleteSession(int sid)
     {
+        lock_guard<recursive_mutex> lk(mtx);
+        if (ParkingSession *temp = unlinkActive(sid))
+        {
+            unindexEntry(temp);
+            // Free up the parking spot
+            ParkingSpot *spot = findSpot(temp->spotId);
+            if (spot)
+                release(spot);
+            delete temp;
+            persist();
+            return true;
+        }
         ParkingSession **ptr = &sessions;
         while (*ptr)
         {
             if ((*ptr)->id == sid)
             {
                 ParkingSession *temp = *ptr;
-                // Free up the parking spot
-                ParkingSpot *spot = findSpot(temp->spotId);
-                if (spot)
-                    spot->isOccupied = false;
                 *ptr = temp->next;
+                unindexEntry(temp);
                 delete temp;
-                saveData();
+                persist();
                 return true;
             }
             ptr = &(*ptr)->next;
         }
-        return false;
+        return deleteArchived(sid);
     }
 
     void displayVehicles()
     {
+        lock_guard<recursive_mutex> lk(mtx);
         cout << "-- Vehicles in " << name << " (" << lotId << ") --\n";
         for (auto *v = vehicles; v; v = v->next)
             cout << "License: " << v->id << " | Type: " << v->type
@@ -222,134 +576,755 @@ public:
 
     void displaySpots()
     {
+        lock_guard<recursive_mutex> lk(mtx);
         cout << "-- Parking Spots in " << name << " (" << lotId << ") --\n";
         for (auto *s = spots; s; s = s->next)
+        {
             cout << s->id << ": " << s->type << " | "
-                 << (s->isOccupied ? "Occupied" : "Available") << "\n";
+                 << (s->isOccupied ? "Occupied" : "Available");
+            if (!s->zone.empty())
+                cout << " | Zone " << s->zone;
+            if (s->level != 0)
+                cout << " | Level " << s->level;
+            if (s->exitDistance >= 0)
+                cout << " | " << s->exitDistance << "m to exit";
+            cout << "\n";
+        }
+    }
+
+    // Current per-type counters; O(spot types), no spot list is walked.
+    vector<TypeOccupancy> occupancy() const
+    {
+        lock_guard<recursive_mutex> lk(mtx);
+        vector<TypeOccupancy> out;
+        out.reserve(pools.size());
+        for (auto &kv : pools)
+            out.push_back({kv.first, kv.second.total, kv.second.occupied});
+        return out;
+    }
+
+    void displayOccupancy()
+    {
+        lock_guard<recursive_mutex> lk(mtx);
+        cout << "-- Occupancy in " << name << " (" << lotId << ") --\n";
+        for (auto &kv : pools)
+            cout << kv.first << ": " << kv.second.occupied << "/" << kv.second.total
+                 << " occupied, " << kv.second.freeCount() << " free\n";
     }
 
     void displaySessions(bool currentOnly = false)
     {
+        lock_guard<recursive_mutex> lk(mtx);
         cout << "-- Parking Sessions in " << name << " (" << lotId << ") --\n";
+        for (auto *s = activeSessions; s; s = s->next)
+            printSession(*s);
+        if (currentOnly)
+            return;
+        for (auto *s = sessions; s; s = s->next)
+            printSession(*s);
+        // Archived days are streamed one segment at a time, newest first.
+        const vector<string> &days = archiveSegments();
+        ParkingSession row;
+        for (auto it = days.rbegin(); it != days.rend(); ++it)
+        {
+            CsvReader r(segmentPath(*it));
+            r.skipHeader();
+            vector<string_view> c;
+            while (r.next(c))
+                if (parseSessionRow(c, row))
+                    printSession(row);
+        }
+    }
+
+    static void printSession(const ParkingSession &s)
+    {
+        cout << s.id << ": " << s.vehicleId << " @ S" << s.spotId << " | "
+             << formatTime(s.entryTime) << " - "
+             << (s.exitTime == 0 ? "Ongoing" : formatTime(s.exitTime)) << "\n";
+    }
+
+    // Sessions that entered in [t0, t1), in entry order, including archived
+    // ones. In-memory sessions come from the entry-time index; archived ones
+    // only from the day segments covering the range, found by binary search
+    // in the cached segment list. O(log n + log d + k) plus the rows of at
+    // most the boundary days' segments.
+    vector<ParkingSession> sessionsBetween(int64_t t0, int64_t t1) const
+    {
+        lock_guard<recursive_mutex> lk(mtx);
+        vector<ParkingSession> out;
+        if (t0 >= t1)
+            return out;
+        const vector<string> &days = archiveSegments();
+        string first = dayKey(t0), last = dayKey(t1 - 1);
+        ParkingSession row;
+        for (auto it = lower_bound(days.begin(), days.end(), first);
+             it != days.end() && *it <= last; ++it)
+        {
+            CsvReader r(segmentPath(*it));
+            r.skipHeader();
+            vector<string_view> c;
+            while (r.next(c))
+                if (parseSessionRow(c, row) && row.entryTime >= t0 && row.entryTime < t1)
+                    out.push_back(row);
+        }
+        for (auto it = byEntry.lower_bound(t0); it != byEntry.end() && it->first < t1; ++it)
+            out.push_back(*it->second);
+        sort(out.begin(), out.end(), [](const ParkingSession &a, const ParkingSession &b)
+             { return a.entryTime < b.entryTime; });
+        return out;
+    }
+
+    // Mean stay in seconds of closed sessions on spots of `type` that
+    // entered within the last `window` seconds; -1 if there were none.
+    double averageDwellTime(const string &type, int64_t window) const
+    {
+        lock_guard<recursive_mutex> lk(mtx);
+        int64_t now = time(0), total = 0, n = 0;
+        string key = typeKey(type);
+        for (auto &s : sessionsBetween(now - window, now + 1))
+        {
+            auto spot = spotIndex.find(s.spotId);
+            if (s.exitTime == 0 || spot == spotIndex.end() || typeKey(spot->second->type) != key)
+                continue;
+            total += s.exitTime - s.entryTime;
+            ++n;
+        }
+        return n ? (double)total / n : -1;
+    }
+
+    // ======== Session Archive ========
+    // Closed sessions that entered before today live in
+    // <lot>_archive/<YYYY-MM-DD>.csv, one segment per entry day, in the
+    // sessions CSV format. Only sessions that are open or entered today stay
+    // on the hot lists and in <lot>_sessions, so a gate event never rewrites
+    // older history. A stay spanning midnight lands in its entry day's
+    // segment at the next roll.
+    string archiveDir() const { return storePrefix + "_archive"; }
+    string segmentPath(const string &day) const { return archiveDir() + "/" + day + ".csv"; }
+
+    // Segment days in ascending order. The directory is listed once; after
+    // that appendSegment() and deleteArchived() keep the list current.
+    const vector<string> &archiveSegments() const
+    {
+        if (segmentsListed)
+            return segmentDays;
+        error_code ec;
+        for (auto &e : filesystem::directory_iterator(archiveDir(), ec))
+            if (e.path().extension() == ".csv")
+                segmentDays.push_back(e.path().stem().string());
+        sort(segmentDays.begin(), segmentDays.end());
+        segmentsListed = true;
+        return segmentDays;
+    }
+
+    // Moves closed sessions that entered before today into their day segments
+    // and rewrites the hot file. Runs at most once per day; returns true if
+    // it saved the lot.
+    bool rollArchive()
+    {
+        lock_guard<recursive_mutex> lk(mtx);
+        string today = dayKey(time(0));
+        if (today == hotDay)
+            return false;
+        map<string, vector<ParkingSession *>> byDay;
         for (auto *s = sessions; s; s = s->next)
         {
-            if (!currentOnly || s->exitTime == "")
-                cout << s->id << ": " << s->vehicleId << " @ S" << s->spotId
-                     << " | " << s->entryTime << " - "
-                     << (s->exitTime == "" ? "Ongoing" : s->exitTime) << "\n";
+            string d = dayKey(s->entryTime);
+            if (d < today)
+                byDay[d].push_back(s);
+        }
+        if (byDay.empty())
+        {
+            hotDay = today;
+            return false;
+        }
+
+        unordered_set<ParkingSession *> archived;
+        bool ok = true;
+        for (auto &kv : byDay)
+        {
+            if (!appendSegment(kv.first, kv.second))
+            {
+                ok = false;
+                continue;
+            }
+            archived.insert(kv.second.begin(), kv.second.end());
+        }
+        // Record the id high-water mark before dropping the sessions from
+        // the hot file, or their ids could be handed out again.
+        string mark = to_string(nextSessionId);
+        if (!writeFileAtomic(archiveDir() + "/next_session_id", mark.data(), mark.size()))
+            return false;
+        ParkingSession **ptr = &sessions;
+        while (*ptr)
+        {
+            ParkingSession *s = *ptr;
+            if (!archived.count(s))
+            {
+                ptr = &s->next;
+                continue;
+            }
+            *ptr = s->next;
+            unindexEntry(s);
+            delete s;
         }
+        if (ok)
+            hotDay = today;
+        else
+            cout << "Warning: could not archive all sessions for " << lotId << "\n";
+        persist();
+        return true;
     }
 
+    // Snapshot format used by saveData(); see TableFiles for which file a
+    // load picks.
+    static inline bool binarySnapshots = false;
+
     void loadData()
     {
-        loadList<Vehicle>(lotId + "_vehicles.csv", vehicles);
-        loadList<ParkingSpot>(lotId + "_spots.csv", spots);
-        loadList<ParkingSession>(lotId + "_sessions.csv", sessions);
+        loadTable<Vehicle>(storePrefix + "_vehicles", vehicles);
+        loadTable<ParkingSpot>(storePrefix + "_spots", spots);
+        loadTable<ParkingSession>(storePrefix + "_sessions", sessions);
+    }
+
+    // Formats the tables under the lot lock and writes them after releasing
+    // it, so gate operations on the lot do not wait for the disk. Writes of
+    // one lot are serialized and never replace a newer snapshot.
+    bool saveData()
+    {
+        vector<PendingFile> files;
+        uint64_t seq;
+        {
+            lock_guard<recursive_mutex> lk(mtx);
+            files.push_back(formatTable<Vehicle>(storePrefix + "_vehicles"));
+            files.push_back(formatTable<ParkingSpot>(storePrefix + "_spots"));
+            files.push_back(formatTable<ParkingSession>(storePrefix + "_sessions"));
+            seq = ++formatted;
+        }
+        lock_guard<mutex> io(ioMtx);
+        if (seq < published)
+            return true;
+        bool ok = publish(files);
+        published = seq;
+        if (!ok)
+            cout << "Warning: could not write data files for " << lotId << "\n";
+        return ok;
     }
 
-    void saveData()
+    // Removes every file this lot owns, in either snapshot format.
+    void deleteFiles()
     {
-        saveVehicles(lotId + "_vehicles.csv");
-        saveSpots(lotId + "_spots.csv");
-        saveSessions(lotId + "_sessions.csv");
+        lock_guard<recursive_mutex> lk(mtx);
+        for (const char *table : {"_vehicles", "_spots", "_sessions"})
+            for (const char *ext : {".csv", ".bin"})
+                remove((storePrefix + table + ext).c_str());
+        error_code ec;
+        filesystem::remove_all(archiveDir(), ec);
+        segmentDays.clear();
+        segmentsListed = true;
     }
 
 private:
-    Vehicle *findVehicle(const string &vId)
+    // Guards everything below and the public lists. Recursive because
+    // public operations call each other (endParkingSessionForPlate ->
+    // endParkingSession -> rollArchive).
+    mutable recursive_mutex mtx;
+    mutex ioMtx; // serializes saveData()'s writes; taken after mtx, never before
+    uint64_t formatted = 0, published = 0; // snapshot sequence numbers
+    bool batching = false, dirty = false;
+    string hotDay; // day the hot list was last rolled for
+    mutable vector<string> segmentDays; // see archiveSegments()
+    mutable bool segmentsListed = false;
+    multimap<int64_t, ParkingSession *> byEntry; // active + hot, by entryTime
+    unordered_map<int, ParkingSession *> activeById;
+    unordered_map<string, ParkingSession *> activeByPlate;
+    unordered_map<int, ParkingSession *> activeBySpot;
+    unordered_map<string, Vehicle *> vehicleIndex;
+    unordered_map<int, ParkingSpot *> spotIndex;
+    unordered_map<string, SpotPool> pools; // keyed by typeKey(ParkingSpot::type)
+
+    void buildSpotPools()
     {
         for (auto *v = vehicles; v; v = v->next)
-            if (v->id == vId)
-                return v;
-        return nullptr;
+            vehicleIndex[v->id] = v;
+        for (auto *s = spots; s; s = s->next)
+            indexSpot(s);
+    }
+    void indexSpot(ParkingSpot *s)
+    {
+        spotIndex[s->id] = s;
+        SpotPool &p = pools[typeKey(s->type)];
+        ++p.total;
+        if (s->isOccupied)
+            ++p.occupied;
+        else
+            p.pushFree(*s);
+    }
+    void unindexSpot(ParkingSpot *s)
+    {
+        spotIndex.erase(s->id);
+        SpotPool &p = pools[typeKey(s->type)];
+        --p.total;
+        if (s->isOccupied)
+            --p.occupied;
+        else
+            p.removeFree(s->id);
+    }
+    void occupy(ParkingSpot *s)
+    {
+        if (s->isOccupied)
+            return;
+        s->isOccupied = true;
+        SpotPool &p = pools[typeKey(s->type)];
+        p.removeFree(s->id);
+        ++p.occupied;
+    }
+    void release(ParkingSpot *s)
+    {
+        if (!s->isOccupied)
+            return;
+        s->isOccupied = false;
+        SpotPool &p = pools[typeKey(s->type)];
+        p.pushFree(*s);
+        --p.occupied;
+    }
+
+    Vehicle *findVehicle(const string &vId)
+    {
+        auto it = vehicleIndex.find(vId);
+        return it == vehicleIndex.end() ? nullptr : it->second;
     }
 
     ParkingSpot *findSpot(int id)
     {
-        for (auto *s = spots; s; s = s->next)
-            if (s->id == id)
-                return s;
-        return nullptr;
+        auto it = spotIndex.find(id);
+        return it == spotIndex.end() ? nullptr : it->second;
     }
 
-    ParkingSession *findSession(int id)
+    // Spot and session lookups below return ids and pointers that are only
+    // valid while mtx is held, so they stay private to the lot's own
+    // operations, which take the spot or end the session under that lock.
+    // The best free spot of the given type (see SpotPool), or -1 if the
+    // type is full. O(1).
+    int allocateSpot(const string &type)
     {
-        for (auto *s = sessions; s; s = s->next)
-            if (s->id == id)
-                return s;
-        return nullptr;
+        auto it = pools.find(typeKey(type));
+        return it == pools.end() ? -1 : it->second.best();
     }
 
-    void updateSpotStatuses()
+    // The best free spot a vehicle of `vehicleType` fits: the top of its
+    // own class's pool, else of the next larger class that has one free.
+    // -1 if every compatible class is full. O(classes); taking the spot is
+    // O(log n).
+    int assignBestSpot(const string &vehicleType)
     {
-        unordered_set<int> occupiedSpots;
-        for (auto *s = sessions; s; s = s->next)
+        auto cls = find(sizeClasses.begin(), sizeClasses.end(), typeKey(vehicleType));
+        if (cls == sizeClasses.end())
+            return allocateSpot(vehicleType);
+        for (; cls != sizeClasses.end(); ++cls)
+        {
+            int sid = allocateSpot(*cls);
+            if (sid >= 0)
+                return sid;
+        }
+        return -1;
+    }
+
+    ParkingSession *activeSessionForPlate(const string &vId) const
+    {
+        auto it = activeByPlate.find(vId);
+        return it == activeByPlate.end() ? nullptr : it->second;
+    }
+
+    void persist()
+    {
+        if (batching)
+            dirty = true;
+        else if (!writer || !writer->enqueue(this))
+            saveData();
+    }
+
+    void linkActive(ParkingSession *s)
+    {
+        s->prev = nullptr;
+        s->next = activeSessions;
+        if (activeSessions)
+            activeSessions->prev = s;
+        activeSessions = s;
+        indexActive(s);
+    }
+
+    void indexActive(ParkingSession *s)
+    {
+        activeById[s->id] = s;
+        activeByPlate[s->vehicleId] = s;
+        activeBySpot[s->spotId] = s;
+    }
+
+    // Removes an open session from the active list and indexes; the caller
+    // owns the returned node.
+    ParkingSession *unlinkActive(int id)
+    {
+        auto it = activeById.find(id);
+        if (it == activeById.end())
+            return nullptr;
+        ParkingSession *s = it->second;
+        activeById.erase(it);
+        (s->prev ? s->prev->next : activeSessions) = s->next;
+        if (s->next)
+            s->next->prev = s->prev;
+        s->prev = nullptr;
+        // Legacy files can hold two open sessions for one plate or spot;
+        // only drop the index entry if it still points at this one.
+        auto byPlate = activeByPlate.find(s->vehicleId);
+        if (byPlate != activeByPlate.end() && byPlate->second == s)
+            activeByPlate.erase(byPlate);
+        auto bySpot = activeBySpot.find(s->spotId);
+        if (bySpot != activeBySpot.end() && bySpot->second == s)
+            activeBySpot.erase(bySpot);
+        return s;
+    }
+
+    // The sessions file holds open and closed sessions together; move the
+    // open ones onto the active list once after loading.
+    void splitActiveSessions()
+    {
+        ParkingSession **ptr = &sessions;
+        while (*ptr)
+        {
+            ParkingSession *s = *ptr;
+            byEntry.emplace(s->entryTime, s);
+            if (s->exitTime != 0)
+            {
+                ptr = &s->next;
+                continue;
+            }
+            *ptr = s->next;
+            linkActive(s);
+        }
+    }
+
+    void unindexEntry(ParkingSession *s)
+    {
+        auto range = byEntry.equal_range(s->entryTime);
+        for (auto it = range.first; it != range.second; ++it)
+            if (it->second == s)
+            {
+                byEntry.erase(it);
+                return;
+            }
+    }
+
+    // One sessions-CSV row; times may be epoch or legacy ctime text.
+    static bool parseSessionRow(const vector<string_view> &c, ParkingSession &s)
+    {
+        if (c.size() < 5 || !parseInt(c[0], s.id) || !parseInt(c[2], s.spotId))
+            return false;
+        s.vehicleId = toString(c[1]);
+        s.entryTime = parseStamp(c[3]);
+        s.exitTime = parseStamp(c[4]);
+        s.next = nullptr;
+        return true;
+    }
+
+    static void writeSessionRow(CsvWriter &w, const ParkingSession &s)
+    {
+        w.field(s.id).field(s.vehicleId).field(s.spotId).field(s.entryTime).field(s.exitTime);
+        w.endRow();
+    }
+
+    // Merges `rows` into the day's segment. Ids already present are skipped,
+    // so re-running after a crash between this and the hot-file rewrite does
+    // not duplicate sessions.
+    bool appendSegment(const string &day, const vector<ParkingSession *> &rows)
+    {
+        error_code ec;
+        filesystem::create_directories(archiveDir(), ec);
+        string path = segmentPath(day);
+        CsvWriter w(path);
+        w.header("id,vehicle_id,spot_id,entry_time,exit_time");
+        unordered_set<int> seen;
+        CsvReader r(path);
+        if (r.ok())
+        {
+            r.skipHeader();
+            vector<string_view> c;
+            ParkingSession row;
+            while (r.next(c))
+            {
+                if (!parseSessionRow(c, row))
+                    continue;
+                seen.insert(row.id);
+                writeSessionRow(w, row);
+            }
+        }
+        for (auto *s : rows)
+            if (!seen.count(s->id))
+                writeSessionRow(w, *s);
+        if (!w.commit())
+            return false;
+        archiveSegments();
+        auto pos = lower_bound(segmentDays.begin(), segmentDays.end(), day);
+        if (pos == segmentDays.end() || *pos != day)
+            segmentDays.insert(pos, day);
+        return true;
+    }
+
+    // Archived sessions are only removed by an explicit delete; the segment
+    // holding the id is rewritten without it.
+    bool deleteArchived(int sid)
+    {
+        const vector<string> &days = archiveSegments();
+        for (size_t i = 0; i < days.size(); ++i)
         {
-            if (s->exitTime == "")
+            string path = segmentPath(days[i]);
+            CsvReader r(path);
+            r.skipHeader();
+            CsvWriter w(path);
+            w.header("id,vehicle_id,spot_id,entry_time,exit_time");
+            vector<string_view> c;
+            ParkingSession row;
+            bool found = false;
+            int kept = 0;
+            while (r.next(c))
             {
-                occupiedSpots.insert(s->spotId);
+                if (!parseSessionRow(c, row))
+                    continue;
+                if (row.id == sid)
+                {
+                    found = true;
+                    continue;
+                }
+                writeSessionRow(w, row);
+                ++kept;
             }
+            if (!found)
+                continue;
+            if (kept > 0)
+                return w.commit();
+            if (remove(path.c_str()) != 0)
+                return false;
+            segmentDays.erase(segmentDays.begin() + i);
+            return true;
         }
+        return false;
+    }
+
+    void updateSpotStatuses()
+    {
         for (auto *spot = spots; spot; spot = spot->next)
+            spot->isOccupied = activeBySpot.count(spot->id);
+    }
+
+    template <typename T>
+    void loadTable(const string &base, T *&head)
+    {
+        TableFiles(base).load([&](const string &fn)
+                              { return loadBinary<T>(fn, head); },
+                              [&](const string &fn)
+                              { loadList<T>(fn, head); });
+    }
+
+    // A formatted table waiting to be written by publish().
+    struct PendingFile
+    {
+        string path, data;
+        string stale; // removed once `path` is written
+    };
+
+    template <typename T>
+    PendingFile formatTable(const string &base)
+    {
+        TableFiles files(base);
+        const string &path = files.target(binarySnapshots);
+        string stale = files.stale(binarySnapshots);
+        if (binarySnapshots)
+            return {path, formatBinary<T>(), stale};
+        else if constexpr (is_same<T, Vehicle>::value)
+            return {path, formatVehicles(path), stale};
+        else if constexpr (is_same<T, ParkingSpot>::value)
+            return {path, formatSpots(path), stale};
+        else
+            return {path, formatSessions(path), stale};
+    }
+
+    static bool publish(const vector<PendingFile> &files)
+    {
+        bool ok = true;
+        for (auto &f : files)
+        {
+            if (!writeFileAtomic(f.path, f.data.data(), f.data.size()))
+            {
+                ok = false;
+                continue;
+            }
+            if (!f.stale.empty())
+                remove(f.stale.c_str());
+        }
+        return ok;
+    }
+
+    template <typename T>
+    bool loadBinary(const string &fn, T *&head)
+    {
+        SnapshotReader r(fn);
+        if constexpr (is_same<T, Vehicle>::value)
+        {
+            if (!r.matches({COL_STRING, COL_STRING, COL_STRING}))
+                return false;
+            for (uint64_t i = 0; i < r.rows(); ++i)
+                head = new Vehicle{toString(r.str(0, i)), toString(r.str(1, i)), toString(r.str(2, i)), head};
+        }
+        else if constexpr (is_same<T, ParkingSpot>::value)
+        {
+            // Snapshots written before spot placement have three columns.
+            bool legacy = r.matches({COL_INT32, COL_STRING, COL_INT32});
+            if (!legacy && !r.matches({COL_INT32, COL_STRING, COL_INT32, COL_STRING, COL_INT32, COL_INT32}))
+                return false;
+            for (uint64_t i = 0; i < r.rows(); ++i)
+            {
+                string zone;
+                int level = 0, exitDistance = -1;
+                if (!legacy)
+                {
+                    zone = toString(r.str(3, i));
+                    level = r.i32(4, i);
+                    exitDistance = r.i32(5, i);
+                }
+                head = new ParkingSpot{r.i32(0, i), toString(r.str(1, i)), r.i32(2, i) != 0,
+                                       zone, level, exitDistance, head};
+            }
+        }
+        else
+        {
+            // Snapshots written before epoch times stored them as text.
+            bool legacy = r.matches({COL_INT32, COL_STRING, COL_INT32, COL_STRING, COL_STRING});
+            if (!legacy && !r.matches({COL_INT32, COL_STRING, COL_INT32, COL_INT64, COL_INT64}))
+                return false;
+            for (uint64_t i = 0; i < r.rows(); ++i)
+            {
+                int64_t entry = legacy ? parseStamp(r.str(3, i)) : r.i64(3, i);
+                int64_t exit = legacy ? parseStamp(r.str(4, i)) : r.i64(4, i);
+                head = new ParkingSession{r.i32(0, i), toString(r.str(1, i)), r.i32(2, i), entry, exit, head};
+            }
+        }
+        return true;
+    }
+
+    template <typename T>
+    string formatBinary()
+    {
+        if constexpr (is_same<T, Vehicle>::value)
+        {
+            SnapshotWriter w({COL_STRING, COL_STRING, COL_STRING});
+            for (auto *v = vehicles; v; v = v->next)
+            {
+                w.str(v->id).str(v->type).str(v->owner);
+                w.endRow();
+            }
+            return w.serialize();
+        }
+        else if constexpr (is_same<T, ParkingSpot>::value)
+        {
+            SnapshotWriter w({COL_INT32, COL_STRING, COL_INT32, COL_STRING, COL_INT32, COL_INT32});
+            for (auto *s = spots; s; s = s->next)
+            {
+                w.i32(s->id).str(s->type).i32(s->isOccupied ? 1 : 0).str(s->zone).i32(s->level).i32(s->exitDistance);
+                w.endRow();
+            }
+            return w.serialize();
+        }
+        else
         {
-            spot->isOccupied = occupiedSpots.count(spot->id);
+            SnapshotWriter w({COL_INT32, COL_STRING, COL_INT32, COL_INT64, COL_INT64});
+            for (auto *list : {activeSessions, sessions})
+                for (auto *s = list; s; s = s->next)
+                {
+                    w.i32(s->id).str(s->vehicleId).i32(s->spotId).i64(s->entryTime).i64(s->exitTime);
+                    w.endRow();
+                }
+            return w.serialize();
         }
     }
 
     template <typename T>
     void loadList(const string &fn, T *&head)
     {
-        ifstream f(fn);
-        if (!f)
+        CsvReader r(fn);
+        if (!r.ok())
             return;
-        string line;
-        getline(f, line);
-        while (getline(f, line))
+        r.skipHeader();
+        vector<string_view> cols;
+        while (r.next(cols))
         {
-            stringstream ss(line);
-            vector<string> cols;
-            string tok;
-            while (getline(ss, tok, ','))
-                cols.push_back(tok);
-
+            if (cols.size() < 3)
+                continue;
             if constexpr (is_same<T, Vehicle>::value)
             {
-                head = new Vehicle{cols[0], cols[1], cols[2], head};
+                head = new Vehicle{toString(cols[0]), toString(cols[1]), toString(cols[2]), head};
             }
             else if constexpr (is_same<T, ParkingSpot>::value)
             {
-                head = new ParkingSpot{stoi(cols[0]), cols[1], cols[2] == "1", head};
+                // zone, level and exit_distance are optional columns.
+                int id;
+                if (!parseInt(cols[0], id))
+                    continue;
+                string zone;
+                int level = 0, exitDistance = -1, n;
+                if (cols.size() >= 6)
+                {
+                    zone = toString(cols[3]);
+                    if (parseInt(cols[4], n))
+                        level = n;
+                    if (parseInt(cols[5], n))
+                        exitDistance = n;
+                }
+                head = new ParkingSpot{id, toString(cols[1]), cols[2] == "1", zone, level, exitDistance, head};
             }
             else
             {
-                head = new ParkingSession{stoi(cols[0]), cols[1],
-                                          stoi(cols[2]), cols[3], cols[4], head};
+                ParkingSession row;
+                if (parseSessionRow(cols, row))
+                {
+                    row.next = head;
+                    head = new ParkingSession(row);
+                }
             }
         }
     }
 
-    void saveVehicles(const string &fn)
+    string formatVehicles(const string &fn)
     {
-        ofstream f(fn);
-        f << "license_plate,type,owner\n";
+        CsvWriter w(fn);
+        w.header("license_plate,type,owner");
         for (auto *v = vehicles; v; v = v->next)
-            f << v->id << ',' << v->type << ',' << v->owner << "\n";
+        {
+            w.field(v->id).field(v->type).field(v->owner);
+            w.endRow();
+        }
+        return w.release();
     }
 
-    void saveSpots(const string &fn)
+    string formatSpots(const string &fn)
     {
-        ofstream f(fn);
-        f << "id,type,is_occupied\n";
+        CsvWriter w(fn);
+        w.header("id,type,is_occupied,zone,level,exit_distance");
         for (auto *s = spots; s; s = s->next)
-            f << s->id << ',' << s->type << ',' << (s->isOccupied ? 1 : 0) << "\n";
+        {
+            w.field(s->id).field(s->type).field(s->isOccupied ? 1 : 0).field(s->zone).field(s->level).field(s->exitDistance);
+            w.endRow();
+        }
+        return w.release();
     }
 
-    void saveSessions(const string &fn)
+    string formatSessions(const string &fn)
     {
-        ofstream f(fn);
-        f << "id,vehicle_id,spot_id,entry_time,exit_time\n";
-        for (auto *s = sessions; s; s = s->next)
-            f << s->id << ',' << s->vehicleId << ',' << s->spotId << ','
-              << s->entryTime << ',' << s->exitTime << "\n";
+        CsvWriter w(fn);
+        w.header("id,vehicle_id,spot_id,entry_time,exit_time");
+        for (auto *list : {activeSessions, sessions})
+            for (auto *s = list; s; s = s->next)
+                writeSessionRow(w, *s);
+        return w.release();
     }
 
     void normalizeCounters()
@@ -358,32 +1333,42 @@ private:
             nextSpotId = max(nextSpotId, s->id + 1);
         for (auto *s = sessions; s; s = s->next)
             nextSessionId = max(nextSessionId, s->id + 1);
+        CsvReader mark(archiveDir() + "/next_session_id");
+        vector<string_view> c;
+        int n;
+        if (mark.ok() && mark.next(c) && !c.empty() && parseInt(c[0], n))
+            nextSessionId = max(nextSessionId, n);
     }
 };
 
 // ======== ParkingNetwork Class ========
+// Lots are addressed by interned node ids internally; the "L<n>" string ids
+// only appear at the menu and file boundary.
+// Adding, deleting or reconnecting lots is done by the menu thread holding
+// netMtx exclusively; gate terminals on other threads hold it shared, so the
+// lot table stays put while they work, and only contend on a lot's own lock.
 class ParkingNetwork
 {
-private:
-    bool areConnected(const string &a, const string &b)
-    {
-        if (adj.find(a) == adj.end())
-            return false;
-        for (const auto &edge : adj[a])
-            if (edge.first == b)
-                return true;
-        return false;
-    }
-
 public:
-    unordered_map<string, ParkingLot *> nodes;
-    unordered_map<string, vector<pair<string, int>>> adj;
+    NodeInterner ids;
+    vector<ParkingLot *> nodes; // indexed by node id, nullptr for free slots
+    Adjacency adj;
     int nextLotIndex = 1;
 
+    // Resolves an external lot id; NO_NODE if it does not exist.
+    uint32_t lookup(const string &id) const
+    {
+        return ids.find(id);
+    }
+
     ParkingNetwork()
     {
-        loadLots();
-        loadConnections();
+        loadSizeClasses();
+        if (store.exists())
+            loadShards();
+        else
+            migrateLegacy();
+        dumper = thread([this]() { dumpLoop(); });
     }
 
     void addParkingLot()
@@ -394,10 +1379,10 @@ public:
         cout << "Location: ";
         string loc;
         getline(cin, loc);
+        unique_lock<shared_mutex> lk(netMtx);
         string id = genId();
-        nodes[id] = new ParkingLot(id, nm, loc);
-        saveLots();
-        saveConnections();
+        insertLot(new ParkingLot(id, nm, loc, store.nodePrefix(id)));
+        saveShard(store.shardOf(id));
         cout << "Added: " << id << "\n";
     }
 
@@ -407,13 +1392,14 @@ public:
         string id;
         getline(cin, id);
         
-        if (!nodes.count(id))
+        uint32_t u = lookup(id);
+        if (u == NO_NODE)
         {
             cout << "Parking lot not found.\n";
             return;
         }
 
-        ParkingLot *lot = nodes[id];
+        ParkingLot *lot = nodes[u];
         cout << "\nCurrent Information:\n";
         cout << "ID: " << lot->lotId << "\n";
         cout << "Name: " << lot->name << "\n";
@@ -452,11 +1438,12 @@ public:
         }
         
         // Update the lot information
+        unique_lock<shared_mutex> lk(netMtx);
         lot->name = newName;
         lot->location = newLocation;
         
         // Save changes to file
-        saveLots();
+        saveShard(store.shardOf(lot->lotId));
         
         cout << "\nParking lot updated successfully!\n";
         cout << "Updated Information:\n";
@@ -470,34 +1457,34 @@ public:
         cout << "Lot ID to delete: ";
         string id;
         getline(cin, id);
-        if (!nodes.count(id))
+        uint32_t u = lookup(id);
+        if (u == NO_NODE)
         {
             cout << "Not found.\n";
             return;
         }
 
-        // Delete associated files
-        remove((id + "_vehicles.csv").c_str());
-        remove((id + "_spots.csv").c_str());
-        remove((id + "_sessions.csv").c_str());
+        unique_lock<shared_mutex> lk(netMtx);
+        // Delete associated files once no save of the lot is pending
+        writer.forget(nodes[u]);
+        nodes[u]->deleteFiles();
+
+        // Shards holding the lot's row or any of its edges
+        set<int> touched{store.shardOf(id)};
+        for (auto &e : adj.neighbours(u))
+            touched.insert(store.edgeShard(id, ids.name(e.to)));
 
         // Remove from network
-        delete nodes[id];
-        nodes.erase(id);
-        adj.erase(id);
+        delete nodes[u];
+        nodes[u] = nullptr;
+        shardLots[store.shardOf(id)].erase(u);
 
-        // Remove from other lots' connections
-        for (auto &kv : adj)
-        {
-            auto &v = kv.second;
-            v.erase(remove_if(v.begin(), v.end(),
-                              [&](auto &p)
-                              { return p.first == id; }),
-                    v.end());
-        }
+        // Remove from neighbouring lots' connections
+        adj.removeNode(u);
+        ids.release(u);
 
-        saveLots();
-        saveConnections();
+        for (int k : touched)
+            saveShard(k);
         cout << "Deleted " << id << "\n";
     }
 
@@ -509,54 +1496,357 @@ public:
         cout << "To Lot ID:   ";
         string b;
         getline(cin, b);
-        if (!nodes.count(a) || !nodes.count(b))
+        uint32_t u = lookup(a), v = lookup(b);
+        if (u == NO_NODE || v == NO_NODE)
         {
             cout << "Invalid IDs.\n";
             return;
         }
-        if (areConnected(a, b))
+        if (u == v)
+        {
+            cout << "Cannot connect a lot to itself.\n";
+            return;
+        }
+        if (adj.connected(u, v))
         {
             cout << "Lots are already connected.\n";
             return;
         }
         int dist = readInt("Distance (meters): ", 0);
-        adj[a].push_back({b, dist});
-        adj[b].push_back({a, dist});
-        saveConnections();
+        unique_lock<shared_mutex> lk(netMtx);
+        adj.connect(u, v, dist);
+        saveShard(store.edgeShard(a, b));
         cout << "Connected " << a << " <-> " << b << "\n";
     }
 
+    // Bulk-loads from,to,distance rows: new pairs are connected, existing
+    // ones get the new distance. Each touched shard is written once at the end.
+    void importConnections(const string &fn)
+    {
+        CsvReader r(fn);
+        if (!r.ok())
+        {
+            cout << "Cannot open " << fn << "\n";
+            return;
+        }
+        r.skipHeader();
+        vector<string_view> cols;
+        set<int> touched;
+        unique_lock<shared_mutex> lk(netMtx);
+        int added = 0, updated = 0, skipped = 0;
+        while (r.next(cols))
+        {
+            int d;
+            uint32_t u = NO_NODE, v = NO_NODE;
+            if (cols.size() >= 3 && parseInt(cols[2], d) && d >= 0)
+            {
+                u = lookup(toString(cols[0]));
+                v = lookup(toString(cols[1]));
+            }
+            if (u == NO_NODE || v == NO_NODE || u == v)
+            {
+                ++skipped;
+                continue;
+            }
+            if (adj.connect(u, v, d))
+                ++added;
+            else if (adj.setWeight(u, v, d))
+                ++updated;
+            touched.insert(store.edgeShard(ids.name(u), ids.name(v)));
+        }
+        for (int k : touched)
+            saveShard(k);
+        cout << "Imported " << added << " new, " << updated << " updated, "
+             << skipped << " skipped.\n";
+    }
+    void importConnections()
+    {
+        cout << "CSV file (from,to,distance): ";
+        string fn;
+        getline(cin, fn);
+        importConnections(fn);
+    }
+
+    // Rewrites every lot's snapshot in the current format
+    // (ParkingLot::binarySnapshots).
+    void convertSnapshots()
+    {
+        for (auto *lot : nodes)
+            if (lot && lot->saveData())
+                cout << "Converted " << lot->lotId << "\n";
+    }
+
+    // ======== Gate Event Ingestion ========
+    // Non-interactive feed for ANPR gates, one event per line:
+    //   IN,<lot>,<plate>,<spot id | spot type | *>[,<epoch>]
+    //   OUT,<lot>,<plate>[,<epoch>]
+    // "*" parks in the best spot the vehicle fits (assignBestSpot). A
+    // missing time means now. Events are applied in memory as they arrive;
+    // every `batchSize` events each touched lot is flushed once, then that
+    // batch's results go to `out` as "<line no>,OK,<session id>" or
+    // "<line no>,ERR,<reason>", so an OK is only reported once it is on disk.
+    // A summary with throughput is written to `log`.
+    void ingestEvents(istream &in, ostream &out, ostream &log, size_t batchSize)
+    {
+        auto start = chrono::steady_clock::now();
+        vector<ParkingLot *> touched;
+        string results, line;
+        size_t lineNo = 0, inBatch = 0, events = 0, errors = 0;
+        vector<string> f;
+        shared_lock<shared_mutex> net(netMtx);
+
+        auto flush = [&]()
+        {
+            bool ok = true;
+            for (auto *lot : touched)
+                ok = lot->endBatch() && ok;
+            touched.clear();
+            if (!ok)
+                log << "Warning: batch ending at line " << lineNo << " was not fully saved\n";
+            out << results;
+            out.flush();
+            results.clear();
+            inBatch = 0;
+        };
+
+        while (getline(in, line))
+        {
+            ++lineNo;
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (line.empty() || line[0] == '#')
+                continue;
+            ++events;
+            string res = applyEvent(line, f, &touched);
+            if (res.compare(0, 3, "ERR") == 0)
+                ++errors;
+            results += to_string(lineNo) + "," + res + "\n";
+            if (++inBatch >= batchSize)
+                flush();
+        }
+        flush();
+
+        double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        log << events << " event(s), " << errors << " error(s) in " << secs << "s";
+        if (secs > 0)
+            log << " (" << (int64_t)(events / secs) << " events/s)";
+        log << "\n";
+    }
+
+    // One gate event from a terminal thread, in the ingestEvents() line
+    // format; returns "OK,<session id>" or "ERR,<reason>". Safe to call from
+    // any number of threads. The lot is saved by the background writer, so
+    // an OK here may precede the write by a moment.
+    string gateEvent(const string &line)
+    {
+        vector<string> f;
+        shared_lock<shared_mutex> lk(netMtx);
+        return applyEvent(line, f, nullptr);
+    }
+
     void listParkingLots()
     {
         cout << "-- Parking Lots --\n";
-        for (auto &kv : nodes)
-            cout << kv.first << " | " << kv.second->name
-                 << " | " << kv.second->location << "\n";
+        for (auto *lot : nodes)
+            if (lot)
+                cout << lot->lotId << " | " << lot->name
+                     << " | " << lot->location << "\n";
     }
 
     void displayNetwork()
     {
         cout << "-- Parking Network --\n";
-        for (auto &kv : adj)
+        for (uint32_t u = 0; u < nodes.size(); ++u)
         {
-            cout << kv.first << " -> ";
-            for (auto &e : kv.second)
-                cout << e.first << "(" << e.second << "m) ";
+            if (!nodes[u] || adj.neighbours(u).empty())
+                continue;
+            cout << ids.name(u) << " -> ";
+            for (auto &e : adj.neighbours(u))
+                cout << ids.name(e.to) << "(" << e.w << "m) ";
             cout << "\n";
         }
     }
 
+    // ======== Network Occupancy ========
+    struct OccupancySnapshot
+    {
+        int64_t takenAt = 0;
+        vector<pair<string, vector<TypeOccupancy>>> lots; // lot id -> types
+        map<string, TypeOccupancy> totals;                 // by spot type
+    };
+
+    // Aggregates every lot's incremental counters in O(lots x types).
+    OccupancySnapshot occupancySnapshot() const
+    {
+        OccupancySnapshot snap;
+        snap.takenAt = time(0);
+        shared_lock<shared_mutex> lk(netMtx);
+        for (auto *lot : nodes)
+        {
+            if (!lot)
+                continue;
+            snap.lots.push_back({lot->lotId, lot->occupancy()});
+            for (auto &t : snap.lots.back().second)
+            {
+                TypeOccupancy &sum = snap.totals[t.type];
+                sum.type = t.type;
+                sum.total += t.total;
+                sum.occupied += t.occupied;
+            }
+        }
+        return snap;
+    }
+
+    void displayOccupancy()
+    {
+        OccupancySnapshot snap = occupancySnapshot();
+        cout << "-- Network Occupancy (" << snap.lots.size() << " lots) --\n";
+        for (auto &kv : snap.totals)
+            cout << kv.first << ": " << kv.second.occupied << "/" << kv.second.total
+                 << " occupied, " << kv.second.total - kv.second.occupied << " free\n";
+    }
+
+    // Occupancy dumps (occupancy.csv / occupancy.json in the parking data
+    // directory) are written by a timer thread every `sec` seconds, whatever
+    // the menu or the gates are doing; 0 disables them. Default 60.
+    void setDumpInterval(int sec)
+    {
+        {
+            lock_guard<mutex> lk(dumpMtx);
+            dumpIntervalSec = sec;
+        }
+        dumpCv.notify_all();
+    }
+
+    // Takes the snapshot and writes it. The snapshot holds the network lock
+    // shared and each lot's lock only long enough to copy its counters.
+    void dumpOccupancy()
+    {
+        writeOccupancy(occupancySnapshot(), store.path("occupancy.csv"), store.path("occupancy.json"));
+    }
+
+    ~ParkingNetwork()
+    {
+        {
+            lock_guard<mutex> lk(dumpMtx);
+            stopDumps = true;
+        }
+        dumpCv.notify_all();
+        dumper.join();
+        writer.stop();
+    }
+
+    // ======== Nearest Available Parking ========
+    struct NearbyLot
+    {
+        string lotId;
+        int64_t distance; // meters
+        int freeSpots;
+    };
+
+    // The k lots closest to `fromLot` by road distance (including itself)
+    // with a free spot of `spotType`, nearest first. The Dijkstra stops once
+    // k lots are found or the frontier passes maxMeters. Candidates are
+    // checked against their O(1) per-type free counters, so no spot list is
+    // walked. Per-node scratch is stamped with a search generation instead
+    // of being cleared, so a query only pays for the nodes it reaches.
+    vector<NearbyLot> findNearestAvailable(const string &fromLot, const string &spotType, size_t k,
+                                           int64_t maxMeters = INT64_MAX)
+    {
+        // Scratch is per thread, so concurrent queries share nothing.
+        static thread_local vector<int64_t> searchDist;
+        static thread_local vector<uint32_t> searchStamp;
+        static thread_local uint32_t searchGen = 0;
+        static thread_local vector<pair<int64_t, uint32_t>> frontier;
+
+        vector<NearbyLot> found;
+        shared_lock<shared_mutex> lk(netMtx);
+        uint32_t src = lookup(fromLot);
+        if (src == NO_NODE || k == 0)
+            return found;
+        uint32_t n = ids.slots();
+        if (searchStamp.size() < n)
+        {
+            searchStamp.resize(n, 0);
+            searchDist.resize(n);
+        }
+        if (++searchGen == 0) // wrapped: stale stamps could match again
+        {
+            fill(searchStamp.begin(), searchStamp.end(), 0);
+            searchGen = 1;
+        }
+        auto distOf = [&](uint32_t u)
+        { return searchStamp[u] == searchGen ? searchDist[u] : INT64_MAX; };
+        auto relax = [&](uint32_t u, int64_t d)
+        {
+            searchStamp[u] = searchGen;
+            searchDist[u] = d;
+            frontier.push_back({d, u});
+            push_heap(frontier.begin(), frontier.end(), greater<pair<int64_t, uint32_t>>());
+        };
+
+        frontier.clear();
+        relax(src, 0);
+        while (!frontier.empty())
+        {
+            pop_heap(frontier.begin(), frontier.end(), greater<pair<int64_t, uint32_t>>());
+            auto [d, u] = frontier.back();
+            frontier.pop_back();
+            if (d > distOf(u))
+                continue;
+            if (d > maxMeters)
+                break;
+            int free = nodes[u] ? nodes[u]->freeSpots(spotType) : 0;
+            if (free > 0)
+            {
+                found.push_back({ids.name(u), d, free});
+                if (found.size() >= k)
+                    break;
+            }
+            for (auto &e : adj.neighbours(u))
+            {
+                int64_t nd = d + e.w;
+                if (nd < distOf(e.to))
+                    relax(e.to, nd);
+            }
+        }
+        return found;
+    }
+
+    void showNearestAvailable()
+    {
+        cout << "From Lot ID: ";
+        string from;
+        getline(cin, from);
+        if (lookup(from) == NO_NODE)
+        {
+            cout << "Not found.\n";
+            return;
+        }
+        cout << "Spot Type: ";
+        string type;
+        getline(cin, type);
+        int k = readInt("How many: ", 1);
+        auto res = findNearestAvailable(from, type, k);
+        if (res.empty())
+            cout << "No reachable lot has a free " << type << " spot.\n";
+        for (auto &r : res)
+            cout << r.lotId << " | " << nodes[lookup(r.lotId)]->name << " | " << r.distance
+                 << "m | " << r.freeSpots << " free\n";
+    }
+
     void manageParkingLot()
     {
         cout << "Parking Lot ID: ";
         string lid;
         getline(cin, lid);
-        if (!nodes.count(lid))
+        uint32_t lu = lookup(lid);
+        if (lu == NO_NODE)
         {
             cout << "Not found.\n";
             return;
         }
-        ParkingLot *lot = nodes[lid];
+        ParkingLot *lot = nodes[lu];
         while (true)
         {
             cout << "\n-- Managing " << lot->name << " (" << lid << ") --\n"
@@ -572,9 +1862,11 @@ public:
                  << "10. Delete Vehicle\n"
                  << "11. Delete Spot\n"
                  << "12. Delete Session\n"
-                 << "13. Go Back\n";
-            int c = readInt("Choose: ", 1, 13);
-            if (c == 13)
+                 << "13. Occupancy by Type\n"
+                 << "14. Recent Sessions Report\n"
+                 << "15. Go Back\n";
+            int c = readInt("Choose: ", 1, 15);
+            if (c == 15)
                 break;
             switch (c)
             {
@@ -600,7 +1892,12 @@ public:
                 cout << "Spot Type: ";
                 string t;
                 getline(cin, t);
-                cout << "Added Spot " << lot->addParkingSpot(t) << "\n";
+                cout << "Zone (blank = none): ";
+                string zone;
+                getline(cin, zone);
+                int level = readInt("Level (0 = ground): ");
+                int dist = readInt("Meters to exit (-1 = unknown): ", -1);
+                cout << "Added Spot " << lot->addParkingSpot(t, zone, level, dist) << "\n";
                 break;
             }
             case 3:
@@ -608,15 +1905,29 @@ public:
                 cout << "Vehicle License: ";
                 string vId;
                 getline(cin, vId);
-                int sid = readInt("Spot ID: ", 1);
-                time_t now = time(0);
-                string entry = ctime(&now);
-                entry.erase(entry.find('\n'));
-                int id = lot->startParkingSession(vId, sid, entry);
+                int sid = readInt("Spot ID (0 = any free spot): ", 0);
+                int64_t entry = time(0);
+                int id;
+                if (sid == 0)
+                {
+                    cout << "Spot Type (blank = best fit for the vehicle): ";
+                    string t;
+                    getline(cin, t);
+                    if (t.empty())
+                        id = lot->startParkingSessionBestSpot(vId, entry);
+                    else
+                        id = lot->startParkingSessionAnySpot(vId, t, entry);
+                }
+                else
+                    id = lot->startParkingSession(vId, sid, entry);
                 if (id == -1)
                     cout << "Invalid IDs\n";
                 else if (id == -2)
                     cout << "Spot occupied\n";
+                else if (id == -3)
+                    cout << "No suitable free spot\n";
+                else if (id == -4)
+                    cout << "Vehicle already has an active session\n";
                 else
                     cout << "Session started: " << id << "\n";
                 break;
@@ -624,10 +1935,7 @@ public:
             case 4:
             {
                 int sid = readInt("Session ID: ", 1);
-                time_t now = time(0);
-                string exit = ctime(&now);
-                exit.erase(exit.find('\n'));
-                if (lot->endParkingSession(sid, exit))
+                if (lot->endParkingSession(sid, time(0)))
                     cout << "Session ended\n";
                 else
                     cout << "Invalid session or already ended\n";
@@ -648,8 +1956,8 @@ public:
             case 9:
             {
                 cout << "-- Connections from " << lid << " --\n";
-                for (auto &e : adj[lid])
-                    cout << e.first << "(" << e.second << "m)\n";
+                for (auto &e : adj.neighbours(lu))
+                    cout << ids.name(e.to) << "(" << e.w << "m)\n";
                 break;
             }
             case 10:
@@ -681,88 +1989,426 @@ public:
                     cout << "Delete failed\n";
                 break;
             }
+            case 13:
+                lot->displayOccupancy();
+                break;
+            case 14:
+            {
+                int hours = readInt("Hours back: ", 1);
+                int64_t now = time(0), window = (int64_t)hours * 3600;
+                auto recent = lot->sessionsBetween(now - window, now + 1);
+                cout << recent.size() << " session(s) entered in the last " << hours << "h\n";
+                for (auto &s : recent)
+                    ParkingLot::printSession(s);
+                cout << "Spot Type for average stay: ";
+                string t;
+                getline(cin, t);
+                double avg = lot->averageDwellTime(t, window);
+                if (avg < 0)
+                    cout << "No completed stays on " << t << " spots\n";
+                else
+                    cout << "Average stay: " << (int64_t)(avg / 60) << " min\n";
+                break;
+            }
             }
         }
     }
 
 private:
+    DataStore store{"parking"};
+    map<int, set<uint32_t>> shardLots; // node ids of the lots in each shard
+
+    mutable shared_mutex netMtx;
+    PersistQueue writer{[](ParkingLot *lot) { lot->saveData(); }};
+
+    mutex dumpMtx; // guards dumpIntervalSec and stopDumps
+    condition_variable dumpCv;
+    int dumpIntervalSec = 60;
+    bool stopDumps = false;
+    thread dumper;
+
+    // Sleeps on dumpCv for the interval and dumps on timeout. A changed
+    // interval restarts the wait; stopDumps ends the thread.
+    void dumpLoop()
+    {
+        unique_lock<mutex> lk(dumpMtx);
+        while (!stopDumps)
+        {
+            if (dumpIntervalSec <= 0)
+            {
+                dumpCv.wait(lk);
+                continue;
+            }
+            if (dumpCv.wait_for(lk, chrono::seconds(dumpIntervalSec)) != cv_status::timeout)
+                continue;
+            lk.unlock();
+            dumpOccupancy();
+            lk.lock();
+        }
+    }
+
+    static void writeOccupancy(const OccupancySnapshot &snap, const string &csvPath, const string &jsonPath)
+    {
+        CsvWriter csv(csvPath);
+        csv.header("taken_at,lot_id,spot_type,total,occupied,free");
+        auto row = [&](const string &lot, const TypeOccupancy &t)
+        {
+            csv.field(snap.takenAt).field(lot).field(t.type).field(t.total).field(t.occupied).field(t.total - t.occupied);
+            csv.endRow();
+        };
+        for (auto &lot : snap.lots)
+            for (auto &t : lot.second)
+                row(lot.first, t);
+        for (auto &kv : snap.totals)
+            row("ALL", kv.second);
+
+        string json = "{\"taken_at\":" + to_string(snap.takenAt) + ",\"lots\":{";
+        auto types = [&](const vector<TypeOccupancy> &ts)
+        {
+            json += '{';
+            for (size_t i = 0; i < ts.size(); ++i)
+                json += (i ? "," : "") + jsonString(ts[i].type) + ":{\"total\":" + to_string(ts[i].total) +
+                        ",\"occupied\":" + to_string(ts[i].occupied) + "}";
+            json += '}';
+        };
+        for (size_t i = 0; i < snap.lots.size(); ++i)
+        {
+            json += (i ? "," : "") + jsonString(snap.lots[i].first) + ":";
+            types(snap.lots[i].second);
+        }
+        json += "},\"totals\":";
+        vector<TypeOccupancy> totals;
+        for (auto &kv : snap.totals)
+            totals.push_back(kv.second);
+        types(totals);
+        json += "}\n";
+
+        if (!csv.commit() || !writeFileAtomic(jsonPath, json.data(), json.size()))
+            cerr << "Warning: could not write the occupancy dump\n";
+    }
+
+    static string jsonString(const string &s)
+    {
+        string out = "\"";
+        for (char c : s)
+        {
+            if (c == '"' || c == '\\')
+                out += '\\';
+            if ((unsigned char)c < 0x20)
+            {
+                char esc[8];
+                snprintf(esc, sizeof esc, "\\u%04x", c);
+                out += esc;
+                continue;
+            }
+            out += c;
+        }
+        return out + "\"";
+    }
+
     string genId() { return "L" + to_string(nextLotIndex++); }
 
-    void loadLots()
+    // size_classes.csv: a "type" header, then one spot type per row from
+    // smallest to largest. Without it ParkingLot's default ladder is used.
+    void loadSizeClasses()
     {
-        ifstream f("parking_lots.csv");
-        if (!f)
+        CsvReader r(store.path("size_classes.csv"));
+        if (!r.ok())
             return;
-        string line;
-        getline(f, line);
-        int maxIdx = 0;
-        while (getline(f, line))
+        r.skipHeader();
+        vector<string> ladder;
+        vector<string_view> cols;
+        while (r.next(cols))
+            if (!cols.empty() && !cols[0].empty())
+                ladder.push_back(ParkingLot::typeKey(toString(cols[0])));
+        if (!ladder.empty())
+            ParkingLot::sizeClasses = ladder;
+    }
+
+    // Applies one gate event; returns "OK,<session id>" or "ERR,<reason>".
+    // With `touched`, lots are put into batch mode the first time an event
+    // touches them; without, each change goes to the background writer.
+    // Callers hold netMtx.
+    string applyEvent(const string &line, vector<string> &f, vector<ParkingLot *> *touched)
+    {
+        f.clear();
+        stringstream ss(line);
+        string field;
+        while (getline(ss, field, ','))
+            f.push_back(field);
+        if (f.size() < 3)
+            return "ERR,malformed";
+        bool in = f[0] == "IN";
+        if (!in && f[0] != "OUT")
+            return "ERR,unknown event " + f[0];
+        if (in && f.size() < 4)
+            return "ERR,malformed";
+        size_t timeCol = in ? 4 : 3;
+        int64_t t = time(0);
+        if (f.size() > timeCol && !(t = parseStamp(f[timeCol])))
+            return "ERR,bad time";
+
+        uint32_t u = lookup(f[1]);
+        if (u == NO_NODE)
+            return "ERR,unknown lot";
+        ParkingLot *lot = nodes[u];
+        if (touched && find(touched->begin(), touched->end(), lot) == touched->end())
+        {
+            lot->beginBatch();
+            touched->push_back(lot);
+        }
+
+        if (!in)
+        {
+            int id = lot->endParkingSessionForPlate(f[2], t);
+            return id < 0 ? "ERR,no open session" : "OK," + to_string(id);
+        }
+        int sid, id;
+        if (parseInt(f[3], sid))
+            id = lot->startParkingSession(f[2], sid, t);
+        else if (f[3] == "*")
+            id = lot->startParkingSessionBestSpot(f[2], t);
+        else
+            id = lot->startParkingSessionAnySpot(f[2], f[3], t);
+        switch (id)
         {
-            stringstream ss(line);
-            string id, nm, loc;
-            getline(ss, id, ',');
-            getline(ss, nm, ',');
-            getline(ss, loc, ',');
-            maxIdx = max(maxIdx, stoi(id.substr(1)));
-            nodes[id] = new ParkingLot(id, nm, loc);
+        case -1:
+            return "ERR,unknown vehicle or spot";
+        case -2:
+            return "ERR,spot occupied";
+        case -3:
+            return "ERR,no free spot";
+        case -4:
+            return "ERR,already parked";
         }
-        nextLotIndex = maxIdx + 1;
+        return "OK," + to_string(id);
     }
 
-    void saveLots()
+    void insertLot(ParkingLot *lot)
     {
-        ofstream f("parking_lots.csv");
-        f << "id,name,location\n";
-        for (auto &kv : nodes)
-            f << kv.first << ',' << kv.second->name
-              << ',' << kv.second->location << "\n";
+        uint32_t u = ids.intern(lot->lotId);
+        if (u >= nodes.size())
+            nodes.resize(u + 1, nullptr);
+        nodes[u] = lot;
+        lot->writer = &writer;
+        shardLots[store.shardOf(lot->lotId)].insert(u);
     }
 
-    void loadConnections()
+    // -- Sharded network files (see DataStore) --
+    // Lots are constructed, and so load their stores, on one thread per
+    // shard; interning and edges are applied afterwards on this thread.
+    void loadShards()
     {
-        ifstream f("connections.csv");
-        if (!f)
-            return;
-        string line;
-        getline(f, line);
-        while (getline(f, line))
+        struct ShardRows
         {
-            stringstream ss(line);
-            string a, b;
-            int d;
-            getline(ss, a, ',');
-            getline(ss, b, ',');
-            ss >> d;
-            if (nodes.count(a) && nodes.count(b))
+            vector<ParkingLot *> lots;
+            vector<tuple<string, string, int>> edges;
+        };
+        vector<int> shards = store.shards();
+        vector<ShardRows> rows(shards.size());
+        DataStore::parallelFor(shards.size(), [&](size_t i)
+                               {
+                                   vector<string_view> cols;
+                                   CsvReader n(store.shardFile(shards[i], "nodes.csv"));
+                                   n.skipHeader();
+                                   while (n.next(cols))
+                                   {
+                                       if (cols.size() < 3 || DataStore::nodeNumber(toString(cols[0])) < 0)
+                                           continue;
+                                       string id = toString(cols[0]);
+                                       rows[i].lots.push_back(new ParkingLot(id, toString(cols[1]), toString(cols[2]),
+                                                                             store.shardFile(shards[i], id)));
+                                   }
+                                   CsvReader e(store.shardFile(shards[i], "edges.csv"));
+                                   e.skipHeader();
+                                   int d;
+                                   while (e.next(cols))
+                                       if (cols.size() >= 3 && parseInt(cols[2], d))
+                                           rows[i].edges.emplace_back(toString(cols[0]), toString(cols[1]), d);
+                               });
+        for (auto &shard : rows)
+            for (auto *lot : shard.lots)
             {
-                adj[a].push_back({b, d});
-                adj[b].push_back({a, d});
+                nextLotIndex = max(nextLotIndex, DataStore::nodeNumber(lot->lotId) + 1);
+                insertLot(lot);
+            }
+        for (auto &shard : rows)
+            for (auto &[a, b, d] : shard.edges)
+            {
+                uint32_t u = lookup(a), v = lookup(b);
+                if (u != NO_NODE && v != NO_NODE)
+                    adj.connect(u, v, d);
             }
-        }
     }
 
-    void saveConnections()
+    // Rewrites nodes.csv and edges.csv of shard k from its member lots in
+    // shardLots. An edge is written by its lower-numbered endpoint, which is
+    // the lot whose shard owns it.
+    bool saveShard(int k)
     {
-        ofstream f("connections.csv");
-        f << "from,to,distance\n";
-        for (auto &kv : adj)
+        error_code ec;
+        filesystem::create_directories(store.shardDir(k), ec);
+        CsvWriter n(store.shardFile(k, "nodes.csv"));
+        CsvWriter e(store.shardFile(k, "edges.csv"));
+        n.header("id,name,location");
+        e.header("from,to,distance");
+        for (uint32_t u : shardLots[k])
         {
-            const string &a = kv.first;
-            for (auto &e : kv.second)
+            ParkingLot *lot = nodes[u];
+            n.field(lot->lotId).field(lot->name).field(lot->location);
+            n.endRow();
+            int num = DataStore::nodeNumber(lot->lotId);
+            for (auto &edge : adj.neighbours(u))
             {
-                const string &b = e.first;
-                int d = e.second;
-                if (a < b)
-                    f << a << ',' << b << ',' << d << "\n";
+                const string &other = ids.name(edge.to);
+                if (num < DataStore::nodeNumber(other))
+                {
+                    e.field(lot->lotId).field(other).field(edge.w);
+                    e.endRow();
+                }
             }
         }
+        bool ok = n.commit() && e.commit();
+        if (!ok)
+            cout << "Warning: could not write " << store.shardDir(k) << "\n";
+        return ok;
+    }
+
+    // First run against a data directory: read the pre-sharding
+    // parking_lots.csv and connections.csv from the working directory, move
+    // each lot's <id>_* files into its shard and write the sharded network.
+    // connections.csv may be shared with the hospital program, so it is left
+    // in place and only lot-to-lot edges are taken. layout.csv is written
+    // last: until every shard is on disk the next start migrates again, and
+    // lots whose files were already moved are loaded from their shards.
+    void migrateLegacy()
+    {
+        vector<array<string, 3>> rows = readLegacyLots("parking_lots.csv");
+        vector<string> known;
+        for (auto &row : rows)
+            known.push_back(row[0]);
+        int moved = store.adoptLegacyFiles(known);
+        set<int> shards;
+        for (auto &[id, name, location] : rows)
+        {
+            insertLot(new ParkingLot(id, name, location, store.nodePrefix(id)));
+            shards.insert(store.shardOf(id));
+        }
+        loadLegacyConnections("connections.csv");
+        bool ok = true;
+        for (int k : shards)
+            ok = saveShard(k) && ok;
+        if (!ok || !store.create())
+        {
+            cout << "Warning: could not write " << store.path("") << "; the migration will be retried\n";
+            return;
+        }
+        if (!known.empty())
+            cout << "Migrated " << known.size() << " lot(s) and " << moved
+                 << " store file(s) into " << store.path("") << "\n";
+    }
+
+    vector<array<string, 3>> readLegacyLots(const string &fn)
+    {
+        vector<array<string, 3>> rows;
+        CsvReader r(fn);
+        if (!r.ok())
+            return rows;
+        r.skipHeader();
+        vector<string_view> cols;
+        while (r.next(cols))
+        {
+            int idx;
+            if (cols.size() < 3 || !parseInt(cols[0].substr(1), idx))
+                continue;
+            nextLotIndex = max(nextLotIndex, idx + 1);
+            rows.push_back({toString(cols[0]), toString(cols[1]), toString(cols[2])});
+        }
+        return rows;
+    }
+
+    void loadLegacyConnections(const string &fn)
+    {
+        CsvReader r(fn);
+        if (!r.ok())
+            return;
+        r.skipHeader();
+        vector<string_view> cols;
+        while (r.next(cols))
+        {
+            int d;
+            if (cols.size() < 3 || !parseInt(cols[2], d))
+                continue;
+            uint32_t u = lookup(toString(cols[0])), v = lookup(toString(cols[1]));
+            if (u != NO_NODE && v != NO_NODE)
+                adj.connect(u, v, d);
+        }
     }
 };
 
 // ======== Main Function ========
-int main()
+int main(int argc, char *argv[])
 {
+    // --binary          save lot stores as binary snapshots this session
+    // --convert FORMAT  rewrite all stores as FORMAT (binary|csv) and exit
+    // --data-dir DIR    data root (default $DATA_DIR, else "data")
+    // --ingest FILE     apply gate events from FILE ("-" = stdin) and exit
+    // --batch N         events per flush when ingesting (default 1000)
+    // --dump-interval S seconds between occupancy dumps (default 60, 0 = off)
+    string convertTo, ingestFrom;
+    int batchSize = 1000, dumpInterval = 60;
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg == "--binary")
+            ParkingLot::binarySnapshots = true;
+        else if (arg == "--data-dir" && i + 1 < argc)
+            DataStore::root = argv[++i];
+        else if (arg == "--convert" && i + 1 < argc)
+            convertTo = argv[++i];
+        else if (arg == "--ingest" && i + 1 < argc)
+            ingestFrom = argv[++i];
+        else if (arg == "--batch" && i + 1 < argc && parseInt(argv[i + 1], batchSize) && batchSize > 0)
+            ++i;
+        else if (arg == "--dump-interval" && i + 1 < argc && parseInt(argv[i + 1], dumpInterval) && dumpInterval >= 0)
+            ++i;
+        else
+        {
+            cout << "Usage: " << argv[0]
+                 << " [--binary] [--data-dir DIR] [--convert binary|csv] [--ingest FILE|- [--batch N]]"
+                 << " [--dump-interval SEC]\n";
+            return 1;
+        }
+    }
     ParkingNetwork pn;
+    pn.setDumpInterval(dumpInterval);
+    if (!ingestFrom.empty())
+    {
+        if (ingestFrom == "-")
+        {
+            pn.ingestEvents(cin, cout, cerr, batchSize);
+            return 0;
+        }
+        ifstream in(ingestFrom);
+        if (!in)
+        {
+            cerr << "Cannot open " << ingestFrom << "\n";
+            return 1;
+        }
+        pn.ingestEvents(in, cout, cerr, batchSize);
+        return 0;
+    }
+    if (!convertTo.empty())
+    {
+        if (convertTo != "binary" && convertTo != "csv")
+        {
+            cout << "Unknown format: " << convertTo << "\n";
+            return 1;
+        }
+        ParkingLot::binarySnapshots = convertTo == "binary";
+        pn.convertSnapshots();
+        return 0;
+    }
     while (true)
     {
         cout << "\n=== Parking Management System ===\n"
@@ -773,9 +2419,12 @@ int main()
              << "5. List Parking Lots\n"
              << "6. Display Network\n"
              << "7. Delete Parking Lot\n"
-             << "8. Exit\n";
-        int choice = readInt("Choose: ", 1, 8);
-        if (choice == 8)
+             << "8. Import Connections\n"
+             << "9. Find Nearest Available Parking\n"
+             << "10. Network Occupancy\n"
+             << "11. Exit\n";
+        int choice = readInt("Choose: ", 1, 11);
+        if (choice == 11)
             break;
         switch (choice)
         {
@@ -800,6 +2449,15 @@ int main()
         case 7:
             pn.deleteParkingLot();
             break;
+        case 8:
+            pn.importConnections();
+            break;
+        case 9:
+            pn.showNearestAvailable();
+            break;
+        case 10:
+            pn.displayOccupancy();
+            break;
         }
     }
     cout << "Goodbye!\n";
@@ -0,0 +1,198 @@
+#ifndef TARIFF
+#define TARIFF
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// ======== Money ========
+// Amounts are whole minor units (1/100 RWF) in an int64_t, so charges and
+// revenue totals are exact and never drift with rounding.
+typedef int64_t Money;
+const Money MONEY_SCALE = 100;
+
+inline string formatMoney(Money m)
+{
+    char buf[32];
+    unsigned long long a = m < 0 ? 0ULL - (unsigned long long)m : (unsigned long long)m;
+    snprintf(buf, sizeof buf, "%s%llu.%02llu", m < 0 ? "-" : "", a / MONEY_SCALE, a % MONEY_SCALE);
+    return buf;
+}
+
+// Parses an amount typed in major units: "500", "12.5" or "12.05".
+inline bool parseMoney(string_view s, Money &out)
+{
+    size_t dot = s.find('.');
+    string_view whole = s.substr(0, dot), frac = dot == string_view::npos ? "" : s.substr(dot + 1);
+    if (whole.empty() || frac.size() > 2 || (dot != string_view::npos && frac.empty()))
+        return false;
+    Money units = 0, cents = 0;
+    for (char c : whole)
+    {
+        if (c < '0' || c > '9' || units > (INT64_MAX - 9) / 10 / MONEY_SCALE)
+            return false;
+        units = units * 10 + (c - '0');
+    }
+    for (size_t i = 0; i < 2; ++i)
+    {
+        char c = i < frac.size() ? frac[i] : '0';
+        if (c < '0' || c > '9')
+            return false;
+        cents = cents * 10 + (c - '0');
+    }
+    out = units * MONEY_SCALE + cents;
+    return true;
+}
+
+// Parses an amount stored in minor units.
+inline bool parseMinor(string_view s, Money &out)
+{
+    auto r = from_chars(s.data(), s.data() + s.size(), out);
+    return r.ec == errc() && r.ptr == s.data() + s.size();
+}
+
+// For amounts kept as float before money was fixed-point.
+inline Money moneyFromFloat(double v)
+{
+    return llround(v * MONEY_SCALE);
+}
+
+// ======== Tariffs ========
+// A stay is charged per started block of blockMinutes. The n-th block of
+// every 24-hour period costs blockPrices[n], the last price repeating for
+// the rest of the period, and no period costs more than dailyCap (0 means
+// uncapped). Stays no longer than graceMinutes are free; longer ones are
+// charged from the start. A proRata tariff charges the block in progress
+// for the minutes used rather than in full.
+struct Tariff
+{
+    int graceMinutes = 0;
+    int blockMinutes = 60;
+    vector<Money> blockPrices;
+    Money dailyCap = 0;
+    bool proRata = false;
+};
+
+inline bool validTariff(const Tariff &t)
+{
+    if (t.graceMinutes < 0 || t.blockMinutes < 1 || t.blockMinutes > 1440 || t.dailyCap < 0 ||
+        t.blockPrices.empty())
+        return false;
+    return all_of(t.blockPrices.begin(), t.blockPrices.end(), [](Money p) { return p >= 0; });
+}
+
+// Block prices as stored: minor units separated by ';'.
+inline string blockPricesText(const vector<Money> &prices)
+{
+    string out;
+    for (size_t i = 0; i < prices.size(); ++i)
+        out += (i ? ";" : "") + to_string(prices[i]);
+    return out;
+}
+
+inline bool parseBlockPrices(string_view s, vector<Money> &out, bool (*parse)(string_view, Money &) = parseMinor)
+{
+    out.clear();
+    while (true)
+    {
+        size_t sep = s.find_first_of(";,");
+        Money p;
+        if (!parse(s.substr(0, sep), p))
+            return false;
+        out.push_back(p);
+        if (sep == string_view::npos)
+            return true;
+        s.remove_prefix(sep + 1);
+    }
+}
+
+inline string describeTariff(const Tariff &t)
+{
+    string out;
+    for (size_t i = 0; i < t.blockPrices.size(); ++i)
+        out += (i ? "/" : "") + formatMoney(t.blockPrices[i]);
+    out += " RWF per " + to_string(t.blockMinutes) + " min";
+    if (t.proRata)
+        out += ", pro rata";
+    if (t.graceMinutes)
+        out += ", " + to_string(t.graceMinutes) + " min free";
+    if (t.dailyCap)
+        out += ", at most " + formatMoney(t.dailyCap) + " RWF a day";
+    return out;
+}
+
+// ======== Compiled Tariff ========
+// The price of every stay length up to a day, rounded up to whole minutes,
+// is worked out once when the tariff is set. Pricing a stay is then two
+// divisions by constants and one lookup, whatever the block schedule.
+class TariffTable
+{
+public:
+    static const int64_t DAY_SECONDS = 86400, DAY_MINUTES = 1440;
+
+    TariffTable() : byMinute(DAY_MINUTES + 1, 0) {}
+
+    explicit TariffTable(const Tariff &t) : byMinute(DAY_MINUTES + 1, 0)
+    {
+        grace = t.graceMinutes * 60LL;
+        int64_t blocks = (DAY_MINUTES + t.blockMinutes - 1) / t.blockMinutes;
+        vector<Money> byBlock(blocks + 1, 0);
+        for (int64_t k = 1; k <= blocks; ++k)
+        {
+            Money p = t.blockPrices.empty() ? 0 : t.blockPrices[min<size_t>(k - 1, t.blockPrices.size() - 1)];
+            byBlock[k] = byBlock[k - 1] + p;
+        }
+        for (int64_t m = 1; m <= DAY_MINUTES; ++m)
+        {
+            int64_t full = m / t.blockMinutes, part = m % t.blockMinutes;
+            if (!part)
+                byMinute[m] = byBlock[full];
+            else if (!t.proRata)
+                byMinute[m] = byBlock[full + 1];
+            else // the started block's price times part / blockMinutes, rounded half up
+                byMinute[m] = byBlock[full] +
+                              ((byBlock[full + 1] - byBlock[full]) * part * 2 + t.blockMinutes) / (2 * t.blockMinutes);
+            if (t.dailyCap > 0)
+                byMinute[m] = min(byMinute[m], t.dailyCap);
+        }
+        fullDay = byMinute[DAY_MINUTES];
+    }
+
+    Money price(int64_t seconds) const
+    {
+        if (seconds <= grace)
+            return 0;
+        int64_t days = seconds / DAY_SECONDS, rest = seconds - days * DAY_SECONDS;
+        return days * fullDay + byMinute[(rest + 59) / 60];
+    }
+
+    // Prices n stays at once for audits. Same result as price(), but
+    // branch-free over plain arrays with the table hoisted out of the loop.
+    void priceBatch(const int64_t *seconds, Money *out, size_t n) const
+    {
+        const Money *table = byMinute.data();
+        const int64_t g = grace;
+        const Money day = fullDay;
+        for (size_t i = 0; i < n; ++i)
+        {
+            int64_t s = max<int64_t>(seconds[i], 0);
+            int64_t days = s / DAY_SECONDS, rest = s - days * DAY_SECONDS;
+            Money p = days * day + table[(rest + 59) / 60];
+            out[i] = p & -Money(s > g); // a mask, so no branch on the grace test
+        }
+    }
+
+private:
+    int64_t grace = 0;
+    Money fullDay = 0;
+    vector<Money> byMinute; // byMinute[m]: a stay of m minutes within one day
+};
+
+#endif